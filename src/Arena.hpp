@@ -0,0 +1,45 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Arena.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:54:11 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef ARENA_HPP
+# define ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump-Arena pro Verbindung für alles, was nur einen Request lang lebt
+// (Request-Strings, Header-Tabellen, Response-Header). Allokation ist ein
+// Zeiger-Inkrement, einzelne Frees gibt es nicht: release() nach der Antwort
+// gibt alles auf einmal zurück. Die ersten INLINE Bytes liegen im Objekt
+// selbst, erst größere Requests holen Blöcke vom Heap.
+// Nicht kopier-/verschiebbar: Container halten Zeiger auf resource().
+class RequestArena
+{
+	public:
+		enum { INLINE = 4096 };
+
+		RequestArena()
+			: _res(_inline, sizeof(_inline), std::pmr::new_delete_resource()) {}
+
+		std::pmr::memory_resource* resource() { return &_res; }
+		// alles frei, nächster Request beginnt wieder im Inline-Puffer
+		void release() { _res.release(); }
+
+	private:
+		RequestArena(const RequestArena&);
+		RequestArena& operator=(const RequestArena&);
+
+		alignas(std::max_align_t) char       _inline[INLINE];
+		std::pmr::monotonic_buffer_resource _res;
+};
+
+#endif
@@ -6,141 +6,329 @@
 /*   By: leokubler <leokubler@student.42.fr>        +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:14 by mhummel           #+#    #+#             */
-/*   Updated: 2025/11/12 12:36:57 by leokubler        ###   ########.fr       */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "CGIHandler.hpp"
+#include "Logger.hpp"
 #include <unistd.h>
 #include <sys/wait.h>
+#include <spawn.h>
+#include <signal.h>
 #include <fcntl.h>
 #include <sstream>
 #include <iostream>
 #include <string.h>
+#include <cstdlib>
+#include <strings.h>
+#include <cstdlib>
+#include <cstdio>
 
 CGIHandler::CGIHandler() {}
 CGIHandler::~CGIHandler() {}
 
-Response CGIHandler::execute(const Request& req)
+static void closePipe(int p[2])
 {
-	Response res;
-	std::string scriptPath = "." + req.path;
+	if (p[0] >= 0) close(p[0]);
+	if (p[1] >= 0) close(p[1]);
+}
+
+// posix_spawn() statt fork(): glibc nimmt clone(CLONE_VM|CLONE_VFORK), es
+// werden keine Page-Tables kopiert – die Startzeit hängt nicht an der
+// Größe des Servers. Im Kind passiert nur noch dup2() + execve().
+// Geschlossen wird im Kind nichts explizit: jeder fd des Servers (Sockets,
+// Listener, epoll, inotify, Cache-Dateien, Logs, Pipes) ist O_CLOEXEC, das
+// Script sieht nur stdin/stdout und das geerbte stderr.
+bool CGIHandler::spawn(const Request& req, const std::string& scriptPath, const std::string& interpreter,
+					   const std::vector<std::string>& staticEnv, CgiProcess& out)
+{
+	int pipeIn[2] = { -1, -1 };
+	int pipeOut[2] = { -1, -1 };
+
+	// CLOEXEC: andere CGIs sollen diese Pipes nicht erben (sonst kommt nie EOF)
+	if (pipe2(pipeIn, O_CLOEXEC) < 0 || pipe2(pipeOut, O_CLOEXEC) < 0)
+	{
+		logMsg(LogLevel::ERROR, "pipe: %s", strerror(errno));
+		closePipe(pipeIn);
+		return false;
+	}
+
+	// envp: feste Einträge der Location + die paar Request-Variablen
+	std::vector<std::string> vars;
+	requestEnv(req, scriptPath, vars);
+	std::vector<char*> envp;
+	envp.reserve(staticEnv.size() + vars.size() + 1);
+	for (size_t i = 0; i < staticEnv.size(); ++i)
+		envp.push_back(const_cast<char*>(staticEnv[i].c_str()));
+	for (size_t i = 0; i < vars.size(); ++i)
+		envp.push_back(const_cast<char*>(vars[i].c_str()));
+	envp.push_back(NULL);
+
+	// argv: Interpreter der Location (z. B. PHP, Python ohne Shebang),
+	// sonst das Script selbst (#!/usr/bin/python3)
+	const std::string& prog = interpreter.empty() ? scriptPath : interpreter;
+	char* argv[3] = { const_cast<char*>(prog.c_str()), NULL, NULL };
+	if (!interpreter.empty())
+		argv[1] = const_cast<char*>(scriptPath.c_str());
+
+	// großer Body liegt schon in einer Datei: direkt als stdin nehmen
+	const RequestBody& body = req.body;
+	posix_spawn_file_actions_t fa;
+	posix_spawn_file_actions_init(&fa);
+	if (body.inFile()) {
+		lseek(body.fd(), 0, SEEK_SET);
+		posix_spawn_file_actions_adddup2(&fa, body.fd(), STDIN_FILENO);
+	} else
+		posix_spawn_file_actions_adddup2(&fa, pipeIn[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&fa, pipeOut[1], STDOUT_FILENO);
+
+	// der Server ignoriert SIGPIPE – das Script bekommt wieder das Default-Verhalten
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	sigset_t def;
+	sigemptyset(&def);
+	sigaddset(&def, SIGPIPE);
+	posix_spawnattr_setsigdefault(&attr, &def);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+	pid_t pid = -1;
+	int err = posix_spawn(&pid, prog.c_str(), &fa, &attr, argv, envp.data());
+	posix_spawn_file_actions_destroy(&fa);
+	posix_spawnattr_destroy(&attr);
+
+	close(pipeIn[0]);
+	close(pipeOut[1]);
+	if (err != 0)
+	{
+		logMsg(LogLevel::ERROR, "posix_spawn %s: %s", prog.c_str(), strerror(err));
+		close(pipeIn[1]);
+		close(pipeOut[0]);
+		return false;
+	}
 
-	// baue Umgebungsvariablen
-	std::map<std::string, std::string> env = buildEnv(req, scriptPath);
+	// Body nur über die Pipe, wenn er im Speicher liegt; sonst stdin sofort zu
+	if (body.empty() || body.inFile())
+	{
+		close(pipeIn[1]);
+		pipeIn[1] = -1;
+	}
+	else
+		fcntl(pipeIn[1], F_SETFL, fcntl(pipeIn[1], F_GETFL) | O_NONBLOCK);
+	fcntl(pipeOut[0], F_SETFL, fcntl(pipeOut[0], F_GETFL) | O_NONBLOCK);
 
-	// führe Script aus
-	std::string output = runCGI(scriptPath, env, req.body);
+	out.pid    = pid;
+	out.in_fd  = pipeIn[1];
+	out.out_fd = pipeOut[0];
+	return true;
+}
 
-	// baue HTTP-Response
-	res.statusCode = 200;
-	res.reasonPhrase = "OK";
-	res.headers["Content-Type"] = "text/html";
-	res.body = output;
-	res.headers["Content-Length"] = std::to_string(res.body.size());
+std::vector<std::string> CGIHandler::staticEnv(const ServerConfig& sc)
+{
+	std::vector<std::string> env;
+	env.push_back("GATEWAY_INTERFACE=CGI/1.1");
+	env.push_back("SERVER_PROTOCOL=HTTP/1.1");
+	env.push_back("SERVER_SOFTWARE=webserv/1.0");
+	env.push_back("SERVER_NAME=" + (sc.server_name.empty() ? sc.listen_host : sc.server_name));
+	env.push_back("SERVER_PORT=" + std::to_string(sc.listen_port));
+	env.push_back("REDIRECT_STATUS=200");  // notwendig für PHP-CGI
+	return env;
+}
 
-	return res;
+void CGIHandler::requestEnv(const Request& req, const std::string& scriptPath, std::vector<std::string>& out)
+{
+	std::string_view type = req.headers.get(H_CONTENT_TYPE);
+	out.push_back(std::string("REQUEST_METHOD=").append(req.method));
+	out.push_back("SCRIPT_FILENAME=" + scriptPath);
+	out.push_back(std::string("SCRIPT_NAME=").append(req.path));
+	out.push_back(std::string("QUERY_STRING=").append(req.query));
+	out.push_back("CONTENT_LENGTH=" + std::to_string(req.body.size()));
+	out.push_back("CONTENT_TYPE=" + (type.empty() ? std::string("text/plain") : std::string(type)));
 }
 
-std::map<std::string, std::string> CGIHandler::buildEnv(const Request& req, const std::string& scriptPath)
+std::map<std::string, std::string> CGIHandler::buildEnv(const Request& req, const std::string& scriptPath,
+													   const std::vector<std::string>& staticEnv)
 {
+	std::vector<std::string> vars(staticEnv);
+	requestEnv(req, scriptPath, vars);
 	std::map<std::string, std::string> env;
-	env["GATEWAY_INTERFACE"] = "CGI/1.1";
-	env["REQUEST_METHOD"] = req.method;
-	env["SCRIPT_FILENAME"] = scriptPath;
-	env["SCRIPT_NAME"] = req.path;
-	env["QUERY_STRING"] = req.query;
-	env["CONTENT_LENGTH"] = std::to_string(req.body.size());
-	env["CONTENT_TYPE"] = "text/plain";
-	env["SERVER_PROTOCOL"] = "HTTP/1.1";
-	env["SERVER_SOFTWARE"] = "webserv/1.0";
-	env["REDIRECT_STATUS"] = "200";  // notwendig für PHP-CGI
+	for (size_t i = 0; i < vars.size(); ++i)
+	{
+		size_t eq = vars[i].find('=');
+		env[vars[i].substr(0, eq)] = vars[i].substr(eq + 1);
+	}
 	return env;
 }
 
-static std::string getInterpreter(const std::string& scriptPath)
+// ---- CgiStream ---------------------------------------------------------
+
+static const size_t MAX_CGI_HEADER = 16384;
+
+static const char* statusText(int code)
 {
-    if (scriptPath.find(".py") != std::string::npos)
-        return "/usr/bin/python3";
-    if (scriptPath.find(".php") != std::string::npos)
-        return "/usr/local/bin/php-cgi";
-    return "";
+	switch (code)
+	{
+		case 200: return "OK";
+		case 201: return "Created";
+		case 204: return "No Content";
+		case 301: return "Moved Permanently";
+		case 302: return "Found";
+		case 303: return "See Other";
+		case 304: return "Not Modified";
+		case 307: return "Temporary Redirect";
+		case 400: return "Bad Request";
+		case 401: return "Unauthorized";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 500: return "Internal Server Error";
+		case 503: return "Service Unavailable";
+		default:  return "Unknown";
+	}
 }
 
-std::string CGIHandler::runCGI(const std::string& scriptPath, const std::map<std::string, std::string>& env, const std::string& body)
+CgiStream::CgiStream()
+	: _scan(0), _http11(true), _keep_alive(false), _sent(false),
+	  _chunked(false), _length_known(false), _length_bad(false), _length(0), _body_sent(0),
+	  _status(200) {}
+
+void CgiStream::setClient(bool http11, bool keep_alive)
 {
-	int pipeIn[2];
-	int pipeOut[2];
+	_http11 = http11;
+	_keep_alive = keep_alive;
+}
 
-	if (pipe(pipeIn) < 0 || pipe(pipeOut) < 0)
+bool CgiStream::feed(const char* data, size_t n, std::string& tx)
+{
+	if (_sent)
+	{
+		body(data, n, tx);
+		return true;
+	}
+	_head.append(data, n);
+	// Leerzeile suchen: "\n\n" oder "\n\r\n"
+	for (size_t i = _scan; i < _head.size(); ++i)
 	{
-		perror("pipe");
-		return "<h1>CGI pipe error</h1>";
+		if (_head[i] != '\n') continue;
+		size_t j = i + 1;
+		if (j < _head.size() && _head[j] == '\r') ++j;
+		if (j < _head.size() && _head[j] == '\n')
+		{
+			if (!sendHead(i + 1, tx)) return false;
+			std::string rest = _head.substr(j + 1);
+			std::string().swap(_head);
+			body(rest.data(), rest.size(), tx);
+			return true;
+		}
 	}
+	_scan = _head.size() > 2 ? _head.size() - 2 : 0;
+	return _head.size() <= MAX_CGI_HEADER;
+}
 
-	pid_t pid = fork();
+bool CgiStream::finish(std::string& tx)
+{
+	if (!_sent)
+		return false;
+	// Script hat vor dem angekündigten Ende aufgehört: Client merkt es nur am close
+	if (_length_known && _body_sent < _length)
+		_length_bad = true;
+	if (_chunked)
+		tx += "0\r\n\r\n";
+	return true;
+}
 
-	if (pid == 0)
+// Header-Block des Scripts -> Statuszeile + Header für den Client
+bool CgiStream::sendHead(size_t head_len, std::string& tx)
+{
+	std::string reason;
+	std::string out;
+	bool has_type = false, has_location = false, has_status = false;
+	size_t pos = 0;
+	while (pos < head_len)
 	{
-		dup2(pipeIn[0], STDIN_FILENO);
-		dup2(pipeOut[1], STDOUT_FILENO);
-		close(pipeIn[1]);
-		close(pipeOut[0]);
+		size_t eol = _head.find('\n', pos);
+		std::string line = _head.substr(pos, eol - pos);
+		pos = eol + 1;
+		if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+		if (line.empty()) continue;
+		size_t colon = line.find(':');
+		if (colon == std::string::npos || colon == 0) return false;
+		std::string name = line.substr(0, colon);
+		size_t v = line.find_first_not_of(" \t", colon + 1);
+		std::string value = (v == std::string::npos) ? "" : line.substr(v);
 
-		// envs bauen
-		char* envp[env.size() + 1];
-		int i = 0;
-		for (std::map<std::string, std::string>::const_iterator it = env.begin(); it != env.end(); ++it)
+		if (strcasecmp(name.c_str(), "Status") == 0)
 		{
-			std::string entry = it->first + "=" + it->second;
-			envp[i++] = strdup(entry.c_str());
+			_status = std::atoi(value.c_str());
+			if (_status < 100 || _status > 999) return false;
+			size_t sp = value.find(' ');
+			if (sp != std::string::npos) reason = value.substr(sp + 1);
+			has_status = true;
+			continue;
 		}
-		envp[i] = NULL;
-
-		// argv bauen
-		std::string interpreter = getInterpreter(scriptPath);
-		char* argv[3];
-		if (!interpreter.empty()) {
-			// z. B. PHP, Python ohne Shebang
-			argv[0] = const_cast<char*>(interpreter.c_str());
-			argv[1] = const_cast<char*>(scriptPath.c_str());
-			argv[2] = NULL;
-			execve(interpreter.c_str(), argv, envp);
-		} else {
-			// Script hat Shebang (#!/usr/bin/python3)
-			argv[0] = const_cast<char*>(scriptPath.c_str());
-			argv[1] = NULL;
-			execve(scriptPath.c_str(), argv, envp);
+		// Hop-by-hop-Header bestimmt der Server selbst
+		if (strcasecmp(name.c_str(), "Connection") == 0 || strcasecmp(name.c_str(), "Transfer-Encoding") == 0
+			|| strcasecmp(name.c_str(), "Keep-Alive") == 0)
+			continue;
+		if (strcasecmp(name.c_str(), "Content-Type") == 0) has_type = true;
+		if (strcasecmp(name.c_str(), "Location") == 0) has_location = true;
+		if (strcasecmp(name.c_str(), "Content-Length") == 0)
+		{
+			if (_length_known || value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+				return false;   // doppelt oder keine Zahl: Framing wäre nicht sicher
+			_length = std::strtoull(value.c_str(), NULL, 10);
+			_length_known = true;
 		}
+		out += name + ": " + value + "\r\n";
+	}
+	// Client-Redirect ohne Status-Header (RFC 3875 6.2.3)
+	if (has_location && !has_status)
+		_status = 302;
+	if (reason.empty())
+		reason = statusText(_status);
+	if (!has_type && !has_location)
+		out += "Content-Type: text/html\r\n";
 
-		perror("execve");
-		exit(1);
-
+	bool no_body = (_status == 204 || _status == 304 || _status < 200);
+	if (no_body)
+	{
+		_length_known = true;
+		_length = 0;
 	}
-	else if (pid > 0)
+	else if (!_length_known && _http11)
 	{
-		close(pipeIn[0]);
-		close(pipeOut[1]);
-
-		// schreibe Request-Body an CGI
-		if (!body.empty())
-			write(pipeIn[1], body.c_str(), body.size());
-		close(pipeIn[1]);
+		_chunked = true;
+		out += "Transfer-Encoding: chunked\r\n";
+	}
+	if (!keepAlive())
+		out += "Connection: close\r\n";
 
-		// lese Ausgabe vom CGI
-		std::ostringstream output;
-		char buffer[4096];
-		ssize_t bytes;
-		while ((bytes = read(pipeOut[0], buffer, sizeof(buffer))) > 0)
-			output.write(buffer, bytes);
-		close(pipeOut[0]);
+	tx += "HTTP/1.1 " + std::to_string(_status) + " " + reason + "\r\n";
+	tx += "Server: webserv/1.0\r\n";
+	tx += out;
+	tx += "\r\n";
+	_sent = true;
+	return true;
+}
 
-		waitpid(pid, NULL, 0);
-		return output.str();
+void CgiStream::body(const char* data, size_t n, std::string& tx)
+{
+	if (n == 0 || _status == 204 || _status == 304) return;
+	if (_chunked)
+	{
+		char hex[20];
+		snprintf(hex, sizeof(hex), "%zx\r\n", n);
+		tx += hex;
+		tx.append(data, n);
+		tx += "\r\n";
+		return;
 	}
-	else
+	if (_length_known && n > _length - _body_sent)
 	{
-		perror("fork");
-		return "<h1>CGI fork error</h1>";
+		// mehr als angekündigt: Rest verwerfen, sonst hält der Client ihn
+		// für den Anfang der nächsten Antwort
+		n = _length - _body_sent;
+		_length_bad = true;
 	}
+	tx.append(data, n);
+	_body_sent += n;
 }
@@ -6,7 +6,7 @@
 /*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:20 by mhummel           #+#    #+#             */
-/*   Updated: 2025/10/21 09:27:21 by mhummel          ###   ########.fr       */
+/*   Updated: 2026/10/18 03:42:46 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -17,6 +17,17 @@
 #include "Response.hpp"
 #include <string>
 #include <map>
+#include <vector>
+#include <sys/types.h>
+
+// Gestartetes CGI: Eltern-Enden der Pipes (non-blocking, CLOEXEC).
+// in_fd ist -1, wenn der Body als Datei direkt auf stdin liegt oder leer ist.
+struct CgiProcess
+{
+	pid_t pid;
+	int   in_fd;
+	int   out_fd;
+};
 
 class CGIHandler
 {
@@ -24,13 +35,60 @@ public:
 	CGIHandler();
 	~CGIHandler();
 
-	// Führt das CGI-Script aus und gibt HTTP-Response zurück
-	Response execute(const Request& req);
+	// Startet das CGI-Script per posix_spawn(), ohne zu warten – der Server
+	// hängt die Pipes an seinen Reactor und liest die Ausgabe asynchron.
+	// interpreter leer = Script direkt ausführen (Shebang).
+	bool spawn(const Request& req, const std::string& scriptPath, const std::string& interpreter,
+			   const std::vector<std::string>& staticEnv, CgiProcess& out);
+	// CGI-Variablen (auch als FastCGI-Params)
+	std::map<std::string, std::string> buildEnv(const Request& req, const std::string& scriptPath,
+												const std::vector<std::string>& staticEnv);
+
+	// Variablen, die für eine Location immer gleich sind ("NAME=wert"),
+	// einmal beim Laden der Config gebaut
+	static std::vector<std::string> staticEnv(const ServerConfig& sc);
 
 private:
-	// Hilfsfunktionen
-	std::map<std::string, std::string> buildEnv(const Request& req, const std::string& scriptPath);
-	std::string runCGI(const std::string& scriptPath, const std::map<std::string, std::string>& env, const std::string& body);
+	// nur die Variablen, die sich pro Request ändern
+	static void requestEnv(const Request& req, const std::string& scriptPath, std::vector<std::string>& out);
+};
+
+// Macht aus der Script-Ausgabe (RFC 3875: Header-Block, Leerzeile, Body)
+// Stück für Stück eine HTTP-Antwort. Status, Content-Type, Location usw.
+// kommen vom Script; der Body geht weiter, sobald er da ist – mit der
+// Content-Length des Scripts, sonst chunked (HTTP/1.1) bzw. bis zum
+// Verbindungsende (HTTP/1.0).
+class CgiStream
+{
+public:
+	CgiStream();
+
+	void setClient(bool http11, bool keep_alive);
+	// hängt die fertigen Antwort-Bytes an tx an; false = kaputter Header-Block
+	bool feed(const char* data, size_t n, std::string& tx);
+	// EOF vom Script; false, wenn nie ein vollständiger Header kam
+	bool finish(std::string& tx);
+
+	bool headerSent() const { return _sent; }
+	// bei Content-Length nur, wenn das Script genau so viele Bytes geliefert hat
+	bool keepAlive() const { return _keep_alive && (_chunked || (_length_known && !_length_bad)); }
+	int  status() const { return _status; }
+
+private:
+	bool sendHead(size_t head_len, std::string& tx);
+	void body(const char* data, size_t n, std::string& tx);
+
+	std::string _head;      // Header-Bytes bis zur Leerzeile
+	size_t      _scan;      // bis hier schon nach der Leerzeile gesucht
+	bool        _http11;
+	bool        _keep_alive;
+	bool        _sent;
+	bool        _chunked;
+	bool        _length_known;
+	bool        _length_bad;    // mehr oder weniger Body als per Content-Length angekündigt
+	size_t      _length;        // angekündigte Länge (nur mit Content-Length vom Script)
+	size_t      _body_sent;
+	int         _status;
 };
 
 #endif
@@ -0,0 +1,156 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compression.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:28:04 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:52:22 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Compression.hpp"
+#include <zlib.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+bool isCompressible(const char* mime)
+{
+	return std::strncmp(mime, "text/", 5) == 0
+		|| std::strcmp(mime, "application/javascript") == 0
+		|| std::strcmp(mime, "application/json") == 0
+		|| std::strcmp(mime, "image/svg+xml") == 0;
+}
+
+// "gzip, deflate;q=0.5, br;q=0" – q-Werte werden nur auf 0/nicht 0 geprüft,
+// bevorzugt wird ohnehin br vor gzip
+AcceptEncoding parseAcceptEncoding(std::string_view header)
+{
+	AcceptEncoding ae = { false, false };
+	if (header.empty()) return ae;
+	bool star = false, star_set = false, br_set = false, gzip_set = false;
+	const std::string h(header);   // strtod() braucht ein '\0' am Ende
+	size_t i = 0;
+	while (i < h.size())
+	{
+		while (i < h.size() && (h[i] == ' ' || h[i] == '\t' || h[i] == ',')) ++i;
+		size_t start = i;
+		while (i < h.size() && h[i] != ',' && h[i] != ';' && h[i] != ' ' && h[i] != '\t') ++i;
+		std::string coding = h.substr(start, i - start);
+		bool ok = true;
+		while (i < h.size() && h[i] != ',')
+		{
+			if (h[i] == ';')
+			{
+				size_t q = h.find_first_not_of(" \t", i + 1);
+				if (q != std::string::npos && (h[q] == 'q' || h[q] == 'Q') && q + 1 < h.size() && h[q + 1] == '=')
+					ok = std::strtod(h.c_str() + q + 2, NULL) > 0.0;
+			}
+			++i;
+		}
+		if (coding.empty()) continue;
+		if (strcasecmp(coding.c_str(), "br") == 0)                    { ae.br = ok; br_set = true; }
+		else if (strcasecmp(coding.c_str(), "gzip") == 0
+			|| strcasecmp(coding.c_str(), "x-gzip") == 0)              { ae.gzip = ok; gzip_set = true; }
+		else if (coding == "*")                                       { star = ok; star_set = true; }
+	}
+	if (star_set)
+	{
+		if (!br_set)   ae.br = star;
+		if (!gzip_set) ae.gzip = star;
+	}
+	return ae;
+}
+
+std::string variantEtag(const std::string& etag, const char* enc)
+{
+	if (etag.size() < 2 || etag[etag.size() - 1] != '"')
+		return etag;
+	return etag.substr(0, etag.size() - 1) + "-" + enc + "\"";
+}
+
+GzipCache::GzipCache(size_t max_bytes, size_t max_object)
+	: hits(0), misses(0), _max_bytes(max_bytes), _max_object(max_object), _bytes(0) {}
+
+void GzipCache::erase(std::unordered_map<std::string, Node>::iterator it)
+{
+	_bytes -= (it->second.data ? it->second.data->size() : 0) + it->first.size();
+	_lru.erase(it->second.lru);
+	_map.erase(it);
+}
+
+// ganze Datei lesen und in einem Rutsch gzip-komprimieren (Level 6 wie gzip -6)
+static bool gzipFile(int fd, size_t len, std::string& out)
+{
+	std::string in(len, '\0');
+	size_t got = 0;
+	while (got < len)
+	{
+		ssize_t n = pread(fd, &in[got], len - got, got);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		got += n;
+	}
+	z_stream zs;
+	std::memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)   // +16 = gzip-Header
+		return false;
+	out.resize(deflateBound(&zs, len));
+	zs.next_in   = (Bytef*)&in[0];
+	zs.avail_in  = len;
+	zs.next_out  = (Bytef*)&out[0];
+	zs.avail_out = out.size();
+	int rc = deflate(&zs, Z_FINISH);
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return rc == Z_STREAM_END;
+}
+
+std::shared_ptr<const std::string> GzipCache::get(const std::shared_ptr<FileEntry>& fe)
+{
+	size_t len = (size_t)fe->st.st_size;
+	if (!fe->isFile() || len < 256 || len > _max_object)
+		return std::shared_ptr<const std::string>();
+
+	std::unordered_map<std::string, Node>::iterator it = _map.find(fe->path);
+	if (it != _map.end())
+	{
+		const Node& n = it->second;
+		const struct stat& st = fe->st;
+		if (!fe->stale && n.dev == st.st_dev && n.ino == st.st_ino && n.size == st.st_size
+			&& n.mtime.tv_sec == st.st_mtim.tv_sec && n.mtime.tv_nsec == st.st_mtim.tv_nsec)
+		{
+			_lru.splice(_lru.begin(), _lru, it->second.lru);
+			++hits;
+			return it->second.data;
+		}
+		erase(it);   // Datei hat sich geändert
+	}
+	++misses;
+
+	std::shared_ptr<std::string> z = std::make_shared<std::string>();
+	if (!gzipFile(fe->file->fd, len, *z))
+		return std::shared_ptr<const std::string>();
+	if (z->size() >= len)
+		z.reset();                      // bringt nichts: nur merken, dass es so ist
+
+	size_t cost = (z ? z->size() : 0) + fe->path.size();
+	if (cost > _max_bytes)
+		return z;                       // ausliefern, aber nicht behalten
+	while (_bytes + cost > _max_bytes && !_lru.empty())
+		erase(_map.find(_lru.back()));
+	_lru.push_front(fe->path);
+	Node& n = _map[fe->path];
+	n.dev   = fe->st.st_dev;
+	n.ino   = fe->st.st_ino;
+	n.size  = fe->st.st_size;
+	n.mtime = fe->st.st_mtim;
+	n.data  = z;
+	n.lru   = _lru.begin();
+	_bytes += cost;
+	return z;
+}
@@ -0,0 +1,74 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compression.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:28:04 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:52:22 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef COMPRESSION_HPP
+# define COMPRESSION_HPP
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include "FileCache.hpp"
+
+// Lohnt sich Kompression für diesen Typ? (Text, JS/JSON, SVG – keine Bilder/Archive)
+bool isCompressible(const char* mime);
+
+// Was der Client laut Accept-Encoding nimmt (q=0 heißt nein)
+struct AcceptEncoding
+{
+	bool br;
+	bool gzip;
+};
+AcceptEncoding parseAcceptEncoding(std::string_view header);   // leer = kein Header
+
+// "\"abc-12\"" + "gz" -> "\"abc-12-gz\"": jede Kodierung braucht ein eigenes ETag
+std::string variantEtag(const std::string& etag, const char* enc);
+
+// Pro Worker: einmal gzip-komprimierte Dateien ohne .gz-Sidecar, LRU mit
+// Byte-Budget. Gültig, solange die Quelle dieselbe Datei ist (Inode, Größe,
+// mtime – wie im ETag) – unabhängig davon, ob der FileCache sie noch hält.
+class GzipCache
+{
+	public:
+		GzipCache(size_t max_bytes, size_t max_object);
+
+		// NULL: zu groß, zu klein oder Kompression bringt nichts (Letzteres
+		// wird auch gemerkt, damit dieselbe Datei nicht jedes Mal neu läuft)
+		std::shared_ptr<const std::string> get(const std::shared_ptr<FileEntry>& fe);
+
+		size_t hits;
+		size_t misses;
+
+	private:
+		typedef std::list<std::string> Lru;
+		struct Node
+		{
+			dev_t                              dev;
+			ino_t                              ino;
+			off_t                              size;
+			struct timespec                    mtime;
+			std::shared_ptr<const std::string> data;   // NULL = negativer Eintrag
+			Lru::iterator                      lru;
+		};
+
+		void erase(std::unordered_map<std::string, Node>::iterator it);
+
+		size_t _max_bytes;
+		size_t _max_object;
+		size_t _bytes;
+		Lru    _lru;
+		std::unordered_map<std::string, Node> _map;
+};
+
+#endif
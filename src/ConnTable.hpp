@@ -0,0 +1,97 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConnTable.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:13:39 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONNTABLE_HPP
+# define CONNTABLE_HPP
+
+#include <stdint.h>
+#include <deque>
+#include <new>
+#include <vector>
+
+// Slot-Map für Verbindungen: stabile Ids, O(1) insert/erase, keine
+// Verschiebung der anderen Einträge beim Schließen.
+// Id = (Generation << 32) | Slot; die Generation wird bei jedem erase()
+// hochgezählt, alte Ids (z. B. aus verspäteten Events) laufen dann ins Leere.
+template <typename T>
+class ConnTable
+{
+	public:
+		typedef uint64_t Id;
+		static const Id NONE = 0;
+
+		ConnTable() : _live(0) {}
+
+		// legt einen leeren Eintrag an und gibt seine Id zurück
+		Id insert()
+		{
+			uint32_t s;
+			if (!_free.empty()) { s = _free.back(); _free.pop_back(); }
+			else { s = (uint32_t)_slots.size(); _slots.emplace_back(); }
+			Slot& sl = _slots[s];
+			sl.live = true;
+			++_live;
+			return makeId(sl.gen, s);
+		}
+
+		T* get(Id id)
+		{
+			uint32_t s = slotOf(id);
+			if (s >= _slots.size()) return NULL;
+			Slot& sl = _slots[s];
+			if (!sl.live || sl.gen != genOf(id)) return NULL;
+			return &sl.value;
+		}
+
+		void erase(Id id)
+		{
+			if (!get(id)) return;
+			Slot& sl = _slots[slotOf(id)];
+			sl.value.~T();                              // Puffer freigeben; neu an Ort und Stelle
+			new (&sl.value) T();                        // (T muss weder kopier- noch verschiebbar sein)
+			sl.live  = false;
+			sl.gen   = (sl.gen + 1) & 0x7fffffff;       // Bit 63 der Id bleibt frei
+			if (sl.gen == 0) sl.gen = 1;
+			_free.push_back(slotOf(id));
+			--_live;
+		}
+
+		size_t size() const { return _live; }
+
+		// ruft f(id, value) für jeden belegten Slot auf; f darf erase(id) aufrufen
+		template <typename F>
+		void forEach(F f)
+		{
+			for (uint32_t s = 0; s < _slots.size(); ++s)
+				if (_slots[s].live)
+					f(makeId(_slots[s].gen, s), _slots[s].value);
+		}
+
+	private:
+		struct Slot
+		{
+			T        value;
+			uint32_t gen;
+			bool     live;
+			Slot() : value(), gen(1), live(false) {}
+		};
+
+		static Id       makeId(uint32_t gen, uint32_t s) { return ((Id)gen << 32) | s; }
+		static uint32_t slotOf(Id id) { return (uint32_t)(id & 0xffffffffu); }
+		static uint32_t genOf(Id id)  { return (uint32_t)(id >> 32); }
+
+		std::deque<Slot>      _slots;   // deque: Adressen bleiben bei push_back stabil
+		std::vector<uint32_t> _free;
+		size_t                _live;
+};
+
+#endif
@@ -0,0 +1,602 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:32:44 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FastCGI.hpp"
+#include "Logger.hpp"
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+// FastCGI 1.0 (https://fastcgi-archives.github.io/FastCGI_Specification.html)
+enum
+{
+	FCGI_VERSION_1         = 1,
+	FCGI_BEGIN_REQUEST     = 1,
+	FCGI_ABORT_REQUEST     = 2,
+	FCGI_END_REQUEST       = 3,
+	FCGI_PARAMS            = 4,
+	FCGI_STDIN             = 5,
+	FCGI_STDOUT            = 6,
+	FCGI_STDERR            = 7,
+	FCGI_GET_VALUES        = 9,
+	FCGI_GET_VALUES_RESULT = 10,
+
+	FCGI_RESPONDER         = 1,
+	FCGI_KEEP_CONN         = 1,
+	FCGI_REQUEST_COMPLETE  = 0,
+	FCGI_OVERLOADED        = 2
+};
+
+static const size_t CHUNK     = 32768;        // Nutzdaten pro Record (max. 65535)
+static const size_t WBUF_HIGH = 256 * 1024;   // mehr stdin wird erst nach dem Senden nachgeschoben
+static const size_t OUT_WINDOW = 256 * 1024;  // so viel STDOUT pro Request, bevor der Client aufholen muss
+static const size_t OUT_HIGH   = 256 * 1024;  // so viel hält ein pausierter Request im Speicher
+
+static void putLength(std::string& out, size_t n)
+{
+	if (n < 128) { out += (char)n; return; }
+	out += (char)(((n >> 24) & 0x7f) | 0x80);
+	out += (char)((n >> 16) & 0xff);
+	out += (char)((n >> 8) & 0xff);
+	out += (char)(n & 0xff);
+}
+
+static void putNameValue(std::string& out, const std::string& name, const std::string& value)
+{
+	putLength(out, name.size());
+	putLength(out, value.size());
+	out += name;
+	out += value;
+}
+
+// Name-Value-Paare (GET_VALUES_RESULT) lesen; false bei kaputten Längen
+static bool getLength(const unsigned char*& p, const unsigned char* end, size_t& n)
+{
+	if (p >= end) return false;
+	if (*p < 128) { n = *p++; return true; }
+	if (end - p < 4) return false;
+	n = ((size_t)(p[0] & 0x7f) << 24) | ((size_t)p[1] << 16) | ((size_t)p[2] << 8) | p[3];
+	p += 4;
+	return true;
+}
+
+static void parseNameValues(const char* data, size_t len, std::map<std::string, std::string>& out)
+{
+	const unsigned char* p   = (const unsigned char*)data;
+	const unsigned char* end = p + len;
+	while (p < end)
+	{
+		size_t nl, vl;
+		if (!getLength(p, end, nl) || !getLength(p, end, vl) || (size_t)(end - p) < nl + vl) return;
+		out[std::string((const char*)p, nl)] = std::string((const char*)p + nl, vl);
+		p += nl + vl;
+	}
+}
+
+bool FcgiPool::isFastCgi(const std::string& target)
+{
+	return target.compare(0, 10, "fastcgi://") == 0;
+}
+
+FcgiPool::FcgiPool(const std::string& address, size_t max_conns, Reactor* reactor, uint64_t tag,
+				   const std::string& temp_dir)
+	: _address(address), _addrlen(0), _max_conns(max_conns ? max_conns : 1), _reactor(reactor), _tag(tag),
+	  _temp_dir(temp_dir)
+{
+	std::memset(&_addr, 0, sizeof(_addr));
+	std::string a = address.substr(10);
+	if (a.compare(0, 5, "unix:") == 0)
+	{
+		sockaddr_un* un = (sockaddr_un*)&_addr;
+		std::string path = a.substr(5);
+		if (path.empty() || path.size() >= sizeof(un->sun_path)) { logMsg(LogLevel::ERROR, "fastcgi: bad socket path %s", address.c_str()); return; }
+		un->sun_family = AF_UNIX;
+		std::memcpy(un->sun_path, path.c_str(), path.size() + 1);
+		_addrlen = sizeof(sockaddr_un);
+		return;
+	}
+	size_t colon = a.rfind(':');
+	if (colon == std::string::npos) { logMsg(LogLevel::ERROR, "fastcgi: missing port in %s", address.c_str()); return; }
+	std::string host = a.substr(0, colon);
+	int port = std::atoi(a.c_str() + colon + 1);
+	if (host == "localhost") host = "127.0.0.1";
+	if (host.size() > 2 && host[0] == '[') host = host.substr(1, host.size() - 2);
+
+	sockaddr_in*  in4 = (sockaddr_in*)&_addr;
+	sockaddr_in6* in6 = (sockaddr_in6*)&_addr;
+	if (port > 0 && port < 65536 && inet_pton(AF_INET, host.c_str(), &in4->sin_addr) == 1)
+	{
+		in4->sin_family = AF_INET;
+		in4->sin_port = htons(port);
+		_addrlen = sizeof(sockaddr_in);
+	}
+	else if (port > 0 && port < 65536 && inet_pton(AF_INET6, host.c_str(), &in6->sin6_addr) == 1)
+	{
+		in6->sin6_family = AF_INET6;
+		in6->sin6_port = htons(port);
+		_addrlen = sizeof(sockaddr_in6);
+	}
+	else
+		logMsg(LogLevel::ERROR, "fastcgi: need a numeric address (or localhost) in %s", address.c_str());
+}
+
+FcgiPool::~FcgiPool()
+{
+	for (std::unordered_map<int, Conn*>::iterator it = _conns.begin(); it != _conns.end(); ++it)
+	{
+		_reactor->remove(it->first);
+		close(it->first);
+		for (std::map<uint16_t, Req*>::iterator r = it->second->reqs.begin(); r != it->second->reqs.end(); ++r)
+			delete r->second;
+		delete it->second;
+	}
+	for (size_t i = 0; i < _queue.size(); ++i)
+		delete _queue[i];
+	for (std::unordered_map<uint64_t, Req*>::iterator it = _reqs.begin(); it != _reqs.end(); ++it)
+		if (it->second->ended)   // hängt an keiner Verbindung mehr
+			delete it->second;
+}
+
+void FcgiPool::record(Conn* c, int type, uint16_t id, const char* data, size_t len)
+{
+	unsigned char h[8] = { FCGI_VERSION_1, (unsigned char)type, (unsigned char)(id >> 8), (unsigned char)id,
+						   (unsigned char)(len >> 8), (unsigned char)len, 0, 0 };
+	c->wbuf.append((const char*)h, 8);
+	c->wbuf.append(data, len);
+}
+
+FcgiPool::Conn* FcgiPool::openConn()
+{
+	int fd = socket(_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) { logMsg(LogLevel::ERROR, "fastcgi socket: %s", strerror(errno)); return NULL; }
+	int rc = connect(fd, (sockaddr*)&_addr, _addrlen);
+	if (rc < 0 && errno != EINPROGRESS)
+	{
+		logMsg(LogLevel::ERROR, "fastcgi connect %s: %s", _address.c_str(), strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	if (_addr.ss_family != AF_UNIX)
+	{
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	if (!_reactor->add(fd, EV_READ | EV_WRITE, _tag | (uint64_t)fd)) { close(fd); return NULL; }
+
+	Conn* c = new Conn();
+	c->fd         = fd;
+	c->events     = EV_READ | EV_WRITE;
+	c->connecting = (rc < 0);
+	c->mpxs       = false;
+	c->woff       = 0;
+	c->next_id    = 1;
+	_conns[fd] = c;
+
+	// nachfragen, ob der Upstream mehrere Requests pro Verbindung kann
+	std::string q;
+	putNameValue(q, "FCGI_MPXS_CONNS", "");
+	record(c, FCGI_GET_VALUES, 0, q.data(), q.size());
+	return c;
+}
+
+// freie Verbindung > neue Verbindung > multiplexende mit den wenigsten Requests
+FcgiPool::Conn* FcgiPool::pickConn()
+{
+	Conn* mpx = NULL;
+	for (std::unordered_map<int, Conn*>::iterator it = _conns.begin(); it != _conns.end(); ++it)
+	{
+		Conn* c = it->second;
+		if (c->reqs.empty()) return c;
+		if (c->mpxs && c->reqs.size() < 65535 && (!mpx || c->reqs.size() < mpx->reqs.size())) mpx = c;
+	}
+	if (_conns.size() < _max_conns)
+	{
+		Conn* c = openConn();
+		if (c) return c;
+	}
+	return mpx;
+}
+
+void FcgiPool::start(Conn* c, Req* r)
+{
+	while (c->next_id == 0 || c->reqs.count(c->next_id)) ++c->next_id;
+	r->id   = c->next_id++;
+	r->conn = c;
+	c->reqs[r->id] = r;
+
+	const char begin[8] = { 0, FCGI_RESPONDER, FCGI_KEEP_CONN, 0, 0, 0, 0, 0 };
+	record(c, FCGI_BEGIN_REQUEST, r->id, begin, sizeof(begin));
+	for (size_t off = 0; off < r->params.size(); off += CHUNK)
+		record(c, FCGI_PARAMS, r->id, r->params.data() + off, std::min(CHUNK, r->params.size() - off));
+	record(c, FCGI_PARAMS, r->id, "", 0);
+	std::string().swap(r->params);
+	if (!r->body || r->body->empty())
+	{
+		record(c, FCGI_STDIN, r->id, "", 0);
+		r->stdin_done = true;
+	}
+}
+
+void FcgiPool::submit(uint64_t client, const std::map<std::string, std::string>& params,
+					  const RequestBody* body, std::vector<FcgiResult>& done)
+{
+	Req* r = new Req();
+	r->client     = client;
+	r->id         = 0;
+	r->conn       = NULL;
+	r->body       = body;
+	r->body_off   = 0;
+	r->stdin_done = false;
+	r->aborted    = false;
+	r->paused     = false;
+	r->sent       = 0;
+	r->held_off   = 0;
+	r->ended      = false;
+	r->end_status = 0;
+	for (std::map<std::string, std::string>::const_iterator it = params.begin(); it != params.end(); ++it)
+		putNameValue(r->params, it->first, it->second);
+	_reqs[client] = r;
+
+	Conn* c = pickConn();
+	if (!c)
+	{
+		if (_conns.empty()) { finish(r, 502, done); return; }   // Upstream nicht erreichbar
+		_queue.push_back(r);
+		return;
+	}
+	start(c, r);
+	if (!service(c))
+		closeConn(c, done);
+}
+
+// stdin-Records nachschieben und den Puffer schreiben, bis EAGAIN oder
+// nichts mehr zu tun ist (auch für edge-triggered epoll)
+bool FcgiPool::service(Conn* c)
+{
+	for (;;)
+	{
+		if (!c->connecting)
+		{
+			for (std::map<uint16_t, Req*>::iterator it = c->reqs.begin(); it != c->reqs.end(); ++it)
+			{
+				Req* r = it->second;
+				while (!r->stdin_done && c->wbuf.size() - c->woff < WBUF_HIGH)
+				{
+					std::string_view b = r->body->view();
+					size_t n = std::min(CHUNK, b.size() - r->body_off);
+					if (n) record(c, FCGI_STDIN, r->id, b.data() + r->body_off, n);
+					r->body_off += n;
+					if (r->body_off == b.size())
+					{
+						record(c, FCGI_STDIN, r->id, "", 0);
+						r->stdin_done = true;
+					}
+				}
+			}
+		}
+		if (c->woff == c->wbuf.size())
+		{
+			c->wbuf.clear();
+			c->woff = 0;
+			break;
+		}
+		if (c->connecting)
+			break;
+		ssize_t n = send(c->fd, c->wbuf.data() + c->woff, c->wbuf.size() - c->woff, MSG_NOSIGNAL);
+		if (n > 0)
+		{
+			c->woff += n;
+			if (c->woff > WBUF_HIGH) { c->wbuf.erase(0, c->woff); c->woff = 0; }
+			continue;
+		}
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		return false;
+	}
+	updateEvents(c);
+	return true;
+}
+
+// der einzige Request der Verbindung hat sein OUT_HIGH voll: nicht weiter
+// lesen, der Kernel-Puffer bremst den Upstream. Mit mehreren Requests (MPXS)
+// wird immer gelesen, damit die anderen nicht mitwarten (siehe hold()).
+bool FcgiPool::blocked(const Conn* c) const
+{
+	if (c->reqs.size() != 1) return false;
+	const Req* r = c->reqs.begin()->second;
+	return r->paused && r->out.size() >= OUT_HIGH;
+}
+
+void FcgiPool::updateEvents(Conn* c)
+{
+	int want = blocked(c) ? 0 : EV_READ;
+	if (c->connecting || c->woff < c->wbuf.size()) want |= EV_WRITE;
+	if (want == c->events) return;
+	c->events = want;
+	_reactor->modify(c->fd, want, _tag | (uint64_t)c->fd);
+}
+
+// alles Lesbare holen und komplette Records auswerten; false = Verbindung zu/kaputt
+bool FcgiPool::readAll(Conn* c, std::vector<FcgiResult>& done)
+{
+	bool open = true;
+	char buf[16384];
+	while (!blocked(c))
+	{
+		ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		if (n <= 0) { open = false; break; }   // EOF oder Fehler
+		c->rbuf.append(buf, n);
+		parse(c, done);
+		// was bisher an STDOUT da ist, gleich weiterreichen (Streaming)
+		for (std::map<uint16_t, Req*>::iterator it = c->reqs.begin(); it != c->reqs.end(); ++it)
+			deliver(it->second, done);
+	}
+	return open;
+}
+
+// STDOUT eines Requests annehmen. Ist er pausiert und teilt sich die
+// Verbindung mit anderen, geht alles über OUT_HIGH in eine anonyme
+// Temp-Datei (wie nginx' fastcgi_temp_path) statt in den Speicher; false,
+// wenn die nicht geschrieben werden kann
+bool FcgiPool::hold(Req* r, const char* data, size_t len)
+{
+	if (r->held.empty() && (!r->paused || r->out.size() + len <= OUT_HIGH || r->conn->reqs.size() == 1))
+	{
+		r->out.append(data, len);
+		return true;
+	}
+	if (r->held.empty())
+	{
+		r->held.setSpill(0, _temp_dir);
+		r->held_off = 0;
+		if (!r->held.append(r->out.data(), r->out.size())) return false;
+		std::string().swap(r->out);
+	}
+	return r->held.append(data, len);
+}
+
+// Gehaltenes an den Server, solange das Fenster des Requests nicht voll ist:
+// erst die Temp-Datei in OUT_WINDOW-Stücken, dann out
+void FcgiPool::deliver(Req* r, std::vector<FcgiResult>& done)
+{
+	if (r->aborted || r->paused) return;
+	std::string out;
+	if (!r->held.empty())
+	{
+		std::string_view v = r->held.view();
+		if (v.size() != r->held.size()) { spillFailed(r, done); return; }
+		size_t n = std::min(OUT_WINDOW, v.size() - r->held_off);
+		out.assign(v.data() + r->held_off, n);
+		r->held_off += n;
+		if (r->held_off == v.size()) { r->held.clear(); r->held_off = 0; }
+	}
+	else
+		out.swap(r->out);
+	if (out.empty()) return;
+	r->sent += out.size();
+	r->paused = (r->sent >= OUT_WINDOW);
+	FcgiResult res;
+	res.client = r->client;
+	res.status = 0;
+	res.final  = false;
+	done.push_back(res);
+	done.back().out.swap(out);
+	if (r->ended && r->held.empty())
+		finish(r, r->end_status, done);
+}
+
+// Temp-Datei kaputt: Request wie bei einem Client-Abbruch beenden, der Client
+// bekommt 502 (bzw. die Verbindung zu, wenn der Header schon raus ist)
+void FcgiPool::spillFailed(Req* r, std::vector<FcgiResult>& done)
+{
+	r->held.clear();
+	if (!r->conn) { finish(r, 502, done); return; }   // END_REQUEST schon da
+	FcgiResult res;
+	res.client = r->client;
+	res.status = 502;
+	res.final  = true;
+	done.push_back(res);
+	_reqs.erase(r->client);
+	r->aborted = true;
+	r->paused  = false;
+	std::string().swap(r->out);
+	record(r->conn, FCGI_ABORT_REQUEST, r->id, "", 0);
+	r->stdin_done = true;
+}
+
+// komplette Records aus rbuf auswerten, ein angefangener bleibt stehen
+void FcgiPool::parse(Conn* c, std::vector<FcgiResult>& done)
+{
+	size_t off = 0;
+	while (c->rbuf.size() - off >= 8)
+	{
+		const unsigned char* h = (const unsigned char*)c->rbuf.data() + off;
+		size_t clen = ((size_t)h[4] << 8) | h[5];
+		size_t total = 8 + clen + h[6];
+		if (c->rbuf.size() - off < total) break;
+		int type = h[1];
+		uint16_t id = (uint16_t)((h[2] << 8) | h[3]);
+		const char* data = (const char*)h + 8;
+		off += total;
+
+		if (type == FCGI_GET_VALUES_RESULT)
+		{
+			std::map<std::string, std::string> v;
+			parseNameValues(data, clen, v);
+			c->mpxs = (v["FCGI_MPXS_CONNS"] == "1");
+			continue;
+		}
+		std::map<uint16_t, Req*>::iterator it = c->reqs.find(id);
+		if (it == c->reqs.end()) continue;
+		Req* r = it->second;
+		if (type == FCGI_STDOUT && !r->aborted)
+		{
+			if (!hold(r, data, clen))
+				spillFailed(r, done);
+		}
+		else if (type == FCGI_STDERR && clen)
+			logMsg(LogLevel::WARN, "fastcgi stderr: %.*s", (int)clen, data);
+		else if (type == FCGI_END_REQUEST)
+		{
+			int proto = clen >= 5 ? (unsigned char)data[4] : (int)FCGI_REQUEST_COMPLETE;
+			int status = proto == FCGI_REQUEST_COMPLETE ? 0 : (proto == FCGI_OVERLOADED ? 503 : 502);
+			c->reqs.erase(it);
+			if (r->held.empty() || r->aborted)
+				finish(r, status, done);
+			else
+			{
+				// Id ist frei, die Temp-Datei wird über resume() noch abgegeben
+				r->ended      = true;
+				r->end_status = status;
+				r->conn       = NULL;
+				deliver(r, done);
+			}
+		}
+	}
+	c->rbuf.erase(0, off);
+}
+
+void FcgiPool::finish(Req* r, int status, std::vector<FcgiResult>& done)
+{
+	std::unordered_map<uint64_t, Req*>::iterator it = _reqs.find(r->client);
+	if (it != _reqs.end() && it->second == r)
+		_reqs.erase(it);
+	if (!r->aborted)
+	{
+		FcgiResult res;
+		res.client = r->client;
+		res.status = status;
+		res.final  = true;
+		done.push_back(res);
+		done.back().out.swap(r->out);
+	}
+	delete r;
+}
+
+void FcgiPool::closeConn(Conn* c, std::vector<FcgiResult>& done)
+{
+	_reactor->remove(c->fd);
+	close(c->fd);
+	_conns.erase(c->fd);
+	for (std::map<uint16_t, Req*>::iterator it = c->reqs.begin(); it != c->reqs.end(); ++it)
+		finish(it->second, 502, done);
+	delete c;
+}
+
+void FcgiPool::drainQueue(std::vector<FcgiResult>& done)
+{
+	while (!_queue.empty())
+	{
+		Conn* c = pickConn();
+		if (!c)
+		{
+			if (!_conns.empty()) return;
+			while (!_queue.empty())   // Upstream nicht erreichbar
+			{
+				Req* r = _queue.front();
+				_queue.pop_front();
+				finish(r, 502, done);
+			}
+			return;
+		}
+		Req* r = _queue.front();
+		_queue.pop_front();
+		start(c, r);
+		if (!service(c))
+			closeConn(c, done);
+	}
+}
+
+void FcgiPool::abort(uint64_t client, std::vector<FcgiResult>& done)
+{
+	std::unordered_map<uint64_t, Req*>::iterator it = _reqs.find(client);
+	if (it == _reqs.end()) return;
+	Req* r = it->second;
+	_reqs.erase(it);
+	r->aborted = true;
+	r->paused  = false;
+	std::string().swap(r->out);
+	r->held.clear();
+	if (!r->conn)
+	{
+		for (std::deque<Req*>::iterator q = _queue.begin(); q != _queue.end(); ++q)
+			if (*q == r) { _queue.erase(q); break; }
+		delete r;
+		return;
+	}
+	Conn* c = r->conn;
+	if (c->mpxs && !c->connecting)
+	{
+		// andere Requests laufen weiter: nur diesen abbrechen, Id wird mit END_REQUEST frei
+		record(c, FCGI_ABORT_REQUEST, r->id, "", 0);
+		r->stdin_done = true;
+		if (!service(c))
+			closeConn(c, done);
+	}
+	else
+		closeConn(c, done);   // einziger Request auf der Verbindung
+	drainQueue(done);
+}
+
+// Client hat alles abgenommen: neues Fenster, Gehaltenes weiterreichen und
+// die Verbindung wieder lesen, falls der Request sie blockiert hat
+void FcgiPool::resume(uint64_t client, std::vector<FcgiResult>& done)
+{
+	std::unordered_map<uint64_t, Req*>::iterator it = _reqs.find(client);
+	if (it == _reqs.end()) return;
+	Req* r = it->second;
+	Conn* c = r->paused ? r->conn : NULL;   // r kann in deliver() fertig werden
+	r->sent   = 0;
+	r->paused = false;
+	deliver(r, done);
+	if (c && !service(c))   // Lesen wieder an, ggf. ABORT_REQUEST raus
+		closeConn(c, done);
+}
+
+void FcgiPool::onEvent(int fd, int ev, std::vector<FcgiResult>& done)
+{
+	std::unordered_map<int, Conn*>::iterator it = _conns.find(fd);
+	if (it == _conns.end()) return;
+	Conn* c = it->second;
+
+	if (c->connecting && (ev & (EV_WRITE | EV_ERROR)))
+	{
+		int err = 0;
+		socklen_t len = sizeof(err);
+		getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+		if (err)
+		{
+			logMsg(LogLevel::ERROR, "fastcgi connect %s: %s", _address.c_str(), strerror(err));
+			closeConn(c, done);
+			drainQueue(done);
+			return;
+		}
+		c->connecting = false;
+	}
+	if ((ev & (EV_READ | EV_ERROR)) && !readAll(c, done))
+	{
+		closeConn(c, done);
+		drainQueue(done);
+		return;
+	}
+	if (!service(c))
+		closeConn(c, done);
+	drainQueue(done);
+}
@@ -0,0 +1,135 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:32:43 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:41:01 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FASTCGI_HPP
+# define FASTCGI_HPP
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <sys/socket.h>
+#include "Reactor.hpp"
+#include "RequestBody.hpp"
+
+// Ausgabe eines FastCGI-Requests: status 0 = ok (out = nächstes Stück
+// CGI-Ausgabe, final beim END_REQUEST), sonst HTTP-Fehlercode (502/503)
+struct FcgiResult
+{
+	uint64_t    client;
+	int         status;
+	bool        final;
+	std::string out;
+};
+
+// FastCGI-Client (Responder-Rolle) mit einem Pool langlebiger Verbindungen
+// zu einem Upstream (z.B. php-fpm). Statt fork()+execve() pro Request gehen
+// die Requests über bestehende Sockets; kann der Upstream multiplexen
+// (FCGI_MPXS_CONNS), teilen sich mehrere Requests eine Verbindung.
+//
+// Alles läuft non-blocking im Event-Loop des Workers: der Pool meldet seine
+// fds selbst beim Reactor an (Token = tag | fd), der Server reicht Events per
+// onEvent() weiter und bekommt fertige Requests in done zurück.
+class FcgiPool
+{
+	public:
+		// address: "fastcgi://127.0.0.1:9000" oder "fastcgi://unix:/run/php.sock",
+		// temp_dir: wohin zurückgehaltene Ausgabe gemultiplexter Requests ausweicht
+		FcgiPool(const std::string& address, size_t max_conns, Reactor* reactor, uint64_t tag,
+				 const std::string& temp_dir);
+		~FcgiPool();
+
+		static bool isFastCgi(const std::string& target);
+		bool valid() const { return _addrlen != 0; }
+
+		// body muss gültig bleiben, bis der Request fertig oder abgebrochen ist
+		void submit(uint64_t client, const std::map<std::string, std::string>& params,
+					const RequestBody* body, std::vector<FcgiResult>& done);
+		void abort(uint64_t client, std::vector<FcgiResult>& done);
+		// Flusskontrolle pro Request: nach OUT_WINDOW weitergereichten Bytes
+		// hält der Pool weitere STDOUT-Daten zurück, bis der Server mit
+		// resume() meldet, dass der Client alles abgenommen hat. Ab OUT_HIGH
+		// ruht eine Verbindung mit nur diesem Request; teilen sich mehrere
+		// Requests die Verbindung (MPXS), wandert der Rest in eine Temp-Datei
+		// und nur dieser Request wartet
+		void resume(uint64_t client, std::vector<FcgiResult>& done);
+
+		bool owns(int fd) const { return _conns.count(fd) != 0; }
+		void onEvent(int fd, int ev, std::vector<FcgiResult>& done);
+
+	private:
+		FcgiPool(const FcgiPool&);
+		FcgiPool& operator=(const FcgiPool&);
+
+		struct Conn;
+		struct Req
+		{
+			uint64_t           client;
+			uint16_t           id;
+			Conn*              conn;
+			std::string        params;      // kodierte FCGI_PARAMS-Records
+			const RequestBody* body;
+			size_t             body_off;
+			bool               stdin_done;
+			bool               aborted;     // Client weg, Ergebnis verwerfen
+			bool               paused;      // Fenster voll, out wird gehalten
+			size_t             sent;        // seit dem letzten resume() weitergereicht
+			std::string        out;
+			RequestBody        held;        // über OUT_HIGH hinaus Gehaltenes (MPXS), liegt vor out
+			size_t             held_off;    // davon schon weitergereicht
+			bool               ended;       // END_REQUEST da, held wird noch abgegeben
+			int                end_status;
+		};
+		struct Conn
+		{
+			int         fd;
+			int         events;
+			bool        connecting;
+			bool        mpxs;               // Upstream kann mehrere Requests pro Verbindung
+			std::string wbuf;
+			size_t      woff;
+			std::string rbuf;
+			uint16_t    next_id;
+			std::map<uint16_t, Req*> reqs;
+		};
+
+		Conn* pickConn();
+		Conn* openConn();
+		void  start(Conn* c, Req* r);
+		bool  service(Conn* c);             // stdin nachschieben + schreiben, false = kaputt
+		bool  readAll(Conn* c, std::vector<FcgiResult>& done);
+		void  parse(Conn* c, std::vector<FcgiResult>& done);
+		bool  hold(Req* r, const char* data, size_t len);
+		void  deliver(Req* r, std::vector<FcgiResult>& done);
+		void  spillFailed(Req* r, std::vector<FcgiResult>& done);
+		bool  blocked(const Conn* c) const;
+		void  record(Conn* c, int type, uint16_t id, const char* data, size_t len);
+		void  finish(Req* r, int status, std::vector<FcgiResult>& done);
+		void  closeConn(Conn* c, std::vector<FcgiResult>& done);
+		void  updateEvents(Conn* c);
+		void  drainQueue(std::vector<FcgiResult>& done);
+
+		std::string             _address;
+		sockaddr_storage        _addr;
+		socklen_t               _addrlen;
+		size_t                  _max_conns;
+		Reactor*                _reactor;
+		uint64_t                _tag;
+		std::string             _temp_dir;
+		std::unordered_map<int, Conn*>     _conns;
+		std::unordered_map<uint64_t, Req*> _reqs;     // nach Client-Id
+		std::deque<Req*>        _queue;               // warten auf eine freie Verbindung
+};
+
+#endif
@@ -0,0 +1,251 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileCache.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:22:35 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FileCache.hpp"
+#include "Logger.hpp"
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+FileBody::~FileBody()
+{
+	if (fd >= 0)
+		close(fd);
+}
+
+// MIME-Mapping (erweiterbar) – ohne Substrings, Endung wird in einen
+// kleinen Puffer kleingeschrieben
+const char* mimeTypeFor(const std::string& path)
+{
+	static const struct { const char* ext; const char* type; } m[] = {
+		{ "html", "text/html" }, { "htm", "text/html" }, { "css", "text/css" },
+		{ "js", "application/javascript" }, { "json", "application/json" },
+		{ "png", "image/png" }, { "jpg", "image/jpeg" }, { "jpeg", "image/jpeg" },
+		{ "gif", "image/gif" }, { "svg", "image/svg+xml" }, { "txt", "text/plain" },
+		{ "pdf", "application/pdf" }, { "ico", "image/x-icon" }
+	};
+	size_t dot = path.find_last_of("./");
+	if (dot == std::string::npos || path[dot] != '.') return "application/octet-stream";
+	char ext[8];
+	size_t n = path.size() - dot - 1;
+	if (n == 0 || n >= sizeof(ext)) return "application/octet-stream";
+	for (size_t i = 0; i < n; ++i)
+	{
+		char c = path[dot + 1 + i];
+		ext[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+	}
+	ext[n] = '\0';
+	for (size_t i = 0; i < sizeof(m) / sizeof(m[0]); ++i)
+		if (std::strcmp(ext, m[i].ext) == 0) return m[i].type;
+	return "application/octet-stream";
+}
+
+// Cache-Key: ohne Slash am Ende und immer mit mindestens einem '/',
+// damit sich Elternverzeichnis und inotify-Name wieder zusammensetzen lassen
+static std::string cacheKey(const std::string& path)
+{
+	std::string k = path;
+	while (k.size() > 1 && k[k.size() - 1] == '/') k.erase(k.size() - 1);
+	if (k.find('/') == std::string::npos) k = "./" + k;
+	return k;
+}
+
+static std::string parentOf(const std::string& key)
+{
+	size_t s = key.rfind('/');
+	if (s == std::string::npos) return ".";
+	if (s == 0) return "/";
+	return key.substr(0, s);
+}
+
+static std::string childOf(const std::string& dir, const char* name)
+{
+	return dir == "/" ? "/" + std::string(name) : dir + "/" + name;
+}
+
+FileCache::FileCache(size_t max_entries)
+	: hits(0), misses(0), _max(max_entries), _ino(-1)
+{
+	if (_max == 0) return;
+	_ino = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_ino < 0)
+		logMsg(LogLevel::WARN, "inotify_init1 (open_file_cache disabled): %s", strerror(errno));
+}
+
+FileCache::~FileCache()
+{
+	clear();
+	if (_ino >= 0) close(_ino);
+}
+
+std::shared_ptr<FileEntry> FileCache::load(const std::string& path)
+{
+	std::shared_ptr<FileEntry> e = std::make_shared<FileEntry>();
+	e->path = path;
+	if (stat(path.c_str(), &e->st) != 0) { e->err = errno; return e; }
+	if (S_ISDIR(e->st.st_mode)) { e->is_dir = true; return e; }
+	if (!S_ISREG(e->st.st_mode)) { e->err = EACCES; return e; }   // FIFOs, Devices: nie öffnen
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+	if (fd < 0) { e->err = errno; return e; }
+	e->file = std::make_shared<FileBody>(fd);
+	fstat(fd, &e->st);            // Werte der tatsächlich geöffneten Datei
+	e->mime = mimeTypeFor(path);
+
+	char buf[64];
+	snprintf(buf, sizeof(buf), "\"%lx-%lx\"", (unsigned long)e->st.st_mtime, (unsigned long)e->st.st_size);
+	e->etag = buf;
+	struct tm tm;
+	gmtime_r(&e->st.st_mtime, &tm);
+	strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	e->last_modified = buf;
+	return e;
+}
+
+std::shared_ptr<FileEntry> FileCache::lookup(const std::string& path)
+{
+	if (_ino < 0)
+		return load(path);
+
+	std::string key = cacheKey(path);
+	std::unordered_map<std::string, Node>::iterator it = _map.find(key);
+	if (it != _map.end())
+	{
+		_lru.splice(_lru.begin(), _lru, it->second.lru);
+		++hits;
+		return it->second.entry;
+	}
+	++misses;
+
+	// Watches vor dem stat() setzen, sonst könnte eine Änderung dazwischen
+	// verloren gehen. Alle Vorfahren beobachten, damit auch ein umbenanntes
+	// Oberverzeichnis die Einträge darunter ungültig macht.
+	for (std::string dir = parentOf(key); ; dir = parentOf(dir))
+	{
+		if (!watchDir(dir))
+			return load(path);    // ohne Watch keine Invalidierung -> nicht cachen
+		if (dir == "." || dir == "/") break;
+	}
+
+	std::shared_ptr<FileEntry> e = load(key);
+	_lru.push_front(key);
+	Node& n = _map[key];
+	n.entry = e;
+	n.lru   = _lru.begin();
+
+	while (_map.size() > _max)
+	{
+		// verdrängte Einträge sieht inotify nicht mehr -> als stale markieren,
+		// damit niemand (z.B. ein Response-Cache) ihnen weiter vertraut
+		std::unordered_map<std::string, Node>::iterator old = _map.find(_lru.back());
+		old->second.entry->stale = true;
+		_map.erase(old);
+		_lru.pop_back();
+	}
+	return e;
+}
+
+bool FileCache::watchDir(const std::string& dir)
+{
+	if (_wd_by_dir.count(dir))
+		return true;
+	int wd = inotify_add_watch(_ino, dir.c_str(),
+		IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+		IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (wd < 0)
+		return false;
+	// derselbe wd kann für einen zweiten Namen desselben Verzeichnisses kommen
+	std::unordered_map<int, std::string>::iterator old = _dir_by_wd.find(wd);
+	if (old != _dir_by_wd.end())
+		_wd_by_dir.erase(old->second);
+	_dir_by_wd[wd]  = dir;
+	_wd_by_dir[dir] = wd;
+	return true;
+}
+
+void FileCache::invalidate(const std::string& key)
+{
+	std::unordered_map<std::string, Node>::iterator it = _map.find(key);
+	if (it == _map.end()) return;
+	it->second.entry->stale = true;
+	_lru.erase(it->second.lru);
+	_map.erase(it);
+}
+
+// alles unterhalb von dir (selten: Verzeichnis gelöscht/umbenannt)
+void FileCache::invalidateDir(const std::string& dir)
+{
+	std::string prefix = dir == "/" ? dir : dir + "/";
+	for (std::unordered_map<std::string, Node>::iterator it = _map.begin(); it != _map.end(); )
+	{
+		if (it->first.compare(0, prefix.size(), prefix) == 0)
+		{
+			it->second.entry->stale = true;
+			_lru.erase(it->second.lru);
+			it = _map.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+void FileCache::clear()
+{
+	for (std::unordered_map<std::string, Node>::iterator it = _map.begin(); it != _map.end(); ++it)
+		it->second.entry->stale = true;
+	_map.clear();
+	_lru.clear();
+}
+
+void FileCache::processEvents()
+{
+	alignas(struct inotify_event) char buf[4096];
+	for (;;)
+	{
+		ssize_t n = read(_ino, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return;   // EAGAIN: alles gelesen
+
+		for (char* p = buf; p < buf + n; )
+		{
+			struct inotify_event* ev = (struct inotify_event*)p;
+			p += sizeof(struct inotify_event) + ev->len;
+
+			if (ev->mask & IN_Q_OVERFLOW) { clear(); continue; }
+			std::unordered_map<int, std::string>::iterator d = _dir_by_wd.find(ev->wd);
+			if (d == _dir_by_wd.end()) continue;
+			std::string dir = d->second;
+
+			if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+			{
+				invalidateDir(dir);
+				if (ev->mask & IN_IGNORED)
+				{
+					_wd_by_dir.erase(dir);
+					_dir_by_wd.erase(d);
+				}
+				else
+					inotify_rm_watch(_ino, ev->wd);   // IN_IGNORED folgt und räumt auf
+				continue;
+			}
+			if (ev->len == 0) continue;
+			std::string child = childOf(dir, ev->name);
+			invalidate(child);
+			if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)))
+				invalidateDir(child);
+		}
+	}
+}
@@ -0,0 +1,100 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileCache.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:22:34 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:22:34 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FILECACHE_HPP
+# define FILECACHE_HPP
+
+#include <string>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <sys/stat.h>
+
+// Offene Datei als Response-Body: der Server schiebt sie per sendfile()
+// direkt aus dem Page-Cache in den Socket, ohne Umweg über res.body
+struct FileBody
+{
+	int fd;
+	explicit FileBody(int f) : fd(f) {}
+	~FileBody();
+
+	private:
+		FileBody(const FileBody&);
+		FileBody& operator=(const FileBody&);
+};
+
+// Alles, was ein statischer GET über einen Pfad wissen muss – einmal per
+// stat()/open() ermittelt und danach aus dem Cache. Auch "gibt es nicht"
+// (err != 0) wird gemerkt, damit 404-Spam keine Syscalls kostet.
+struct FileEntry
+{
+	std::string path;
+	int         err = 0;                 // 0 oder errno von stat()/open()
+	struct stat st;
+	bool        is_dir = false;
+	std::shared_ptr<FileBody> file;      // nur bei regulären Dateien
+	const char* mime = "application/octet-stream";
+	std::string etag;                    // "mtime-size" (hex), wie nginx
+	std::string last_modified;           // IMF-fixdate
+	bool        stale = false;           // per inotify verworfen, nicht mehr benutzen
+
+	bool isFile() const { return err == 0 && !is_dir && file; }
+};
+
+const char* mimeTypeFor(const std::string& path);
+
+// Pro Worker ein begrenzter LRU-Cache über aufgelöste Dateisystem-Pfade.
+// Gültig bleibt ein Eintrag, bis inotify im Elternverzeichnis eine Änderung
+// meldet – dann fliegt er raus (und wird als stale markiert, falls noch
+// eine Response ihn hält). max_entries == 0 schaltet den Cache ab.
+class FileCache
+{
+	public:
+		explicit FileCache(size_t max_entries);
+		~FileCache();
+
+		std::shared_ptr<FileEntry> lookup(const std::string& path);
+		static std::shared_ptr<FileEntry> load(const std::string& path);  // ohne Cache
+
+		int    fd() const { return _ino; }    // inotify-fd für den Reactor, -1 = aus
+		void   processEvents();               // bei EV_READ auf fd() aufrufen
+		size_t size() const { return _map.size(); }
+
+		size_t hits;
+		size_t misses;
+
+	private:
+		FileCache(const FileCache&);
+		FileCache& operator=(const FileCache&);
+
+		typedef std::list<std::string> Lru;
+		struct Node
+		{
+			std::shared_ptr<FileEntry> entry;
+			Lru::iterator              lru;
+		};
+
+		bool watchDir(const std::string& dir);
+		void invalidate(const std::string& key);
+		void invalidateDir(const std::string& dir);
+		void clear();
+
+		size_t _max;
+		int    _ino;
+		Lru    _lru;                                        // vorne = zuletzt benutzt
+		std::unordered_map<std::string, Node> _map;
+		std::unordered_map<int, std::string>  _dir_by_wd;
+		std::unordered_map<std::string, int>  _wd_by_dir;
+};
+
+#endif
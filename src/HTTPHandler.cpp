@@ -6,157 +6,174 @@
 /*   By: leokubler <leokubler@student.42.fr>        +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:22 by mhummel           #+#    #+#             */
-/*   Updated: 2025/11/14 10:26:39 by leokubler        ###   ########.fr       */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "HTTPHandler.hpp"
 #include <iostream>
 #include <sstream>
+#include <cstring>
+#include <strings.h>
 
-RequestParser::RequestParser() {};
-
-RequestParser::~RequestParser() {};
-
-static bool decodeChunkedBody(std::istream& stream, std::string& out, std::string& err)
+// Token-Liste ("keep-alive, Upgrade") case-insensitive nach tok durchsuchen
+static bool hasToken(std::string_view v, const char* tok)
 {
-    out.clear();
-    std::string line;
-
-    while (true) {
-        // Lese die Size-Line (hex [;extensions]) terminated by CRLF
-        if (!std::getline(stream, line)) { err = "unexpected EOF reading chunk size"; return false; }
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-
-        // ignore any empty lines before the size (robustness)
-        if (line.empty()) continue;
-
-        size_t sem = line.find(';');
-        std::string sizeStr = (sem == std::string::npos) ? line : line.substr(0, sem);
+    size_t n = strlen(tok);
+    size_t i = 0;
+    while (i < v.size())
+    {
+        while (i < v.size() && (v[i] == ' ' || v[i] == '\t' || v[i] == ',')) ++i;
+        size_t start = i;
+        while (i < v.size() && v[i] != ',') ++i;
+        size_t end = i;
+        while (end > start && (v[end - 1] == ' ' || v[end - 1] == '\t')) --end;
+        if (end - start == n && strncasecmp(v.data() + start, tok, n) == 0) return true;
+    }
+    return false;
+}
 
-        size_t chunkSize = 0;
-        try {
-            chunkSize = std::stoul(sizeStr, nullptr, 16);
-        } catch (...) {
-            err = "invalid chunk size";
-            return false;
-        }
+RequestParser::RequestParser() { reset(); }
 
-        if (chunkSize == 0) {
-            // letzte Chunk: consume optional trailer headers until empty line
-            while (std::getline(stream, line)) {
-                if (!line.empty() && line.back() == '\r') line.pop_back();
-                if (line.empty()) break;
-            }
-            return true;
-        }
+RequestParser::~RequestParser() {};
 
-        // Lese exakt chunkSize Bytes
-        std::string chunk;
-        chunk.resize(chunkSize);
-        stream.read(&chunk[0], static_cast<std::streamsize>(chunkSize));
-        std::streamsize got = stream.gcount();
-        if (static_cast<size_t>(got) != chunkSize) { err = "incomplete chunk data"; return false; }
-        out.append(chunk);
-
-        // Nach dem Chunk muss ein CRLF kommen; versuchen sauber zu konsumieren
-        // Lese zwei Zeichen; toleriere LF allein (robust gegen einige senders).
-        int c1 = stream.get();
-        if (c1 == EOF) { err = "missing chunk terminator (EOF)"; return false; }
-        if (c1 == '\n') {
-            // ok (lenient)
-            continue;
-        }
-        if (c1 == '\r') {
-            int c2 = stream.get();
-            if (c2 == EOF) { err = "missing chunk terminator (EOF)"; return false; }
-            if (c2 == '\n') continue;
-            // unexpected char after '\r'
-            err = "invalid chunk terminator";
-            return false;
-        }
-        // unexpected char (neither LF nor CR)
-        err = "invalid chunk terminator";
-        return false;
-    }
-    // unreachable
-    return false;
+void RequestParser::reset()
+{
+    _buf = NULL;
+    _pos = 0;
+    _state = S_START;
+    _error = 0;
+    _mark = 0;
+    _value_end = 0;
+    _method = _target = _version = Span();
+    _nheaders = 0;
 }
 
-Request RequestParser::parse(const std::string& rawRequest)
+// RFC 9110 tchar
+static inline bool isToken(unsigned char c)
 {
-    Request req;
-    std::istringstream stream(rawRequest);
-    std::string line;
-
-    // Read and parse the request-line once
-    if (!std::getline(stream, line))
-        return req; // empty request
-    if (!line.empty() && line.back() == '\r')
-        line.pop_back();
-    parseRequestLine(line, req);
-
-    // Read headers
-    while (std::getline(stream, line))
-    {
-        if (!line.empty() && line.back() == '\r')
-            line.pop_back();
-        if (line.empty())
-            break;
-        parseHeaderLine(line, req);
-    }
+    if (c >= '0' && c <= '9') return true;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return true;
+    return c && strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
 
-    // Connection / keep-alive logic
-    if (req.version == "HTTP/1.1")
-        req.keep_alive = !(req.headers.count("Connection") && req.headers["Connection"] == "close");
-    else if (req.version == "HTTP/1.0")
-        req.keep_alive = (req.headers.count("Connection") && req.headers["Connection"] == "keep-alive");
-    else
-        std::cerr << "Invalid HTTP version" << std::endl;
+RequestParser::Status RequestParser::feed(const char* buf, size_t len, size_t max_header_bytes)
+{
+    _buf = buf;   // Puffer kann seit dem letzten Aufruf umgezogen sein, Offsets bleiben gültig
+    if (_state == S_DONE)
+        return _error ? ERROR : DONE;
 
-    // Transfer-Encoding / Content-Length
-    if (req.headers.count("Transfer-Encoding") && req.headers["Transfer-Encoding"] == "chunked")
-    {
-        req.is_chunked = true;
-    }
-    else if (req.headers.count("Content-Length"))
+    while (_pos < len)
     {
-        try {
-            req.content_len = std::stoul(req.headers["Content-Length"]);
-        } catch (const std::exception& e) {
-            std::cerr << "Invalid Content-Length: " << e.what() << std::endl;
-            req.content_len = 0;
-        }
-    }
+        if (_pos >= max_header_bytes)
+            return fail(_state <= S_VERSION ? 414 : 431);
 
-    // Body: prefer exact Content-Length when provided
-    if (req.is_chunked)
-    {
-        std::string err;
-        if (!decodeChunkedBody(stream, req.body, err))
+        unsigned char ch = (unsigned char)buf[_pos];
+        switch (_state)
         {
-            std::cerr << "Chunked decode error: " << err << std::endl;
-            req.body.clear();
+            case S_START:               // leere Zeilen vor der Request-Line sind erlaubt
+                if (ch == '\r' || ch == '\n') break;
+                if (!isToken(ch)) return fail(400);
+                _mark = _pos;
+                _state = S_METHOD;
+                break;
+
+            case S_METHOD:
+                if (ch == ' ') {
+                    _method.off = (uint32_t)_mark; _method.len = (uint32_t)(_pos - _mark);
+                    _mark = _pos + 1;
+                    _state = S_TARGET;
+                }
+                else if (!isToken(ch)) return fail(400);
+                break;
+
+            case S_TARGET:
+                if (ch == ' ') {
+                    if (_pos == _mark) return fail(400);
+                    _target.off = (uint32_t)_mark; _target.len = (uint32_t)(_pos - _mark);
+                    _mark = _pos + 1;
+                    _state = S_VERSION;
+                }
+                else if (ch < 0x21 || ch == 0x7f) return fail(400);
+                else if (_pos - _mark >= MAX_REQUEST_LINE) return fail(414);
+                break;
+
+            case S_VERSION:
+                if (ch == '\r' || ch == '\n') {
+                    _version.off = (uint32_t)_mark; _version.len = (uint32_t)(_pos - _mark);
+                    std::string_view v = view(_version);
+                    if (v.size() != 8 || v.compare(0, 5, "HTTP/") != 0) return fail(400);
+                    if (v != "HTTP/1.1" && v != "HTTP/1.0") return fail(505);
+                    _state = (ch == '\r') ? S_RL_LF : S_HDR_START;
+                }
+                else if (ch < 0x21 || ch == 0x7f) return fail(400);
+                break;
+
+            case S_RL_LF:
+            case S_HDR_LF:
+                if (ch != '\n') return fail(400);
+                _state = S_HDR_START;
+                break;
+
+            case S_HDR_START:
+                if (ch == '\r') { _state = S_END_LF; break; }
+                if (ch == '\n') { ++_pos; _state = S_DONE; return DONE; }
+                if (!isToken(ch)) return fail(400);          // auch obs-fold (SP/HT)
+                if (_nheaders >= MAX_HEADERS) return fail(431);
+                _mark = _pos;
+                _state = S_NAME;
+                break;
+
+            case S_NAME:
+                if (ch == ':') {
+                    Field& f = _headers[_nheaders];
+                    f.name.off = (uint32_t)_mark; f.name.len = (uint32_t)(_pos - _mark);
+                    _state = S_OWS;
+                }
+                else if (!isToken(ch)) return fail(400);     // kein Whitespace vor ':'
+                break;
+
+            case S_OWS:
+                if (ch == ' ' || ch == '\t') break;
+                _mark = _value_end = _pos;
+                _state = S_VALUE;
+                /* fallthrough */
+            case S_VALUE:
+                if (ch == '\r' || ch == '\n') {
+                    Field& f = _headers[_nheaders++];
+                    f.value.off = (uint32_t)_mark; f.value.len = (uint32_t)(_value_end - _mark);
+                    _state = (ch == '\r') ? S_HDR_LF : S_HDR_START;
+                }
+                else if ((ch < 0x20 && ch != '\t') || ch == 0x7f) return fail(400);
+                else if (ch != ' ' && ch != '\t') _value_end = _pos + 1;
+                break;
+
+            case S_END_LF:
+                if (ch != '\n') return fail(400);
+                ++_pos;
+                _state = S_DONE;
+                return DONE;
+
+            case S_DONE:
+                return DONE;
         }
+        ++_pos;
     }
-    else if (req.content_len > 0)
-    {
-        std::string body;
-        body.resize(req.content_len);
-        stream.read(&body[0], req.content_len);
-        std::streamsize actuallyRead = stream.gcount();
-        body.resize(static_cast<size_t>(actuallyRead));
-        req.body = body;
-    }
-    else
+    return NEED_MORE;
+}
+
+std::string_view RequestParser::header(std::string_view name, bool* found) const
+{
+    for (size_t i = 0; i < _nheaders; ++i)
     {
-        // read any remaining data
-        std::string rest;
-        std::getline(stream, rest, '\0');
-        req.body = rest;
+        std::string_view n = view(_headers[i].name);
+        if (n.size() == name.size() && strncasecmp(n.data(), name.data(), n.size()) == 0) {
+            if (found) *found = true;
+            return view(_headers[i].value);
+        }
     }
-
-    return req;
+    if (found) *found = false;
+    return std::string_view();
 }
 
 static inline std::string trim(const std::string& s)
@@ -167,9 +184,8 @@ static inline std::string trim(const std::string& s)
     return s.substr(a, b - a + 1);
 }
 
-static std::map<std::string,std::string> parseCookieHeader(const std::string& header)
+static void parseCookieHeader(const std::string& header, std::pmr::map<std::pmr::string, std::pmr::string>& out)
 {
-    std::map<std::string,std::string> out;
     size_t pos = 0;
     while (pos < header.size()) {
         // split by ';'
@@ -179,38 +195,61 @@ static std::map<std::string,std::string> parseCookieHeader(const std::string& he
         if (eq != std::string::npos) {
             std::string k = trim(pair.substr(0, eq));
             std::string v = trim(pair.substr(eq + 1));
-            out[k] = v;
+            out[std::pmr::string(k, out.get_allocator())].assign(v);
         }
         if (semi == std::string::npos) break;
         pos = semi + 1;
     }
-    return out;
-}
-
-void RequestParser::parseRequestLine(const std::string& line, Request& req)
-{
-	std::istringstream ss(line);
-	ss >> req.method >> req.path >> req.version;
-
-	if (req.method.empty() || req.path.empty() || req.version.empty())
-		std::cerr << "Invalid request line" << std::endl;
 }
 
-void RequestParser::parseHeaderLine(const std::string& line, Request& req)
+bool RequestParser::build(Request& req) const
 {
-	size_t pos = line.find(':');
-	if (pos == std::string::npos)
-		return;
-
-	std::string key = line.substr(0, pos);
-	std::string value = line.substr(pos + 1);
-
-
-	if (!value.empty() && value[0] == ' ')
-        value.erase(0, 1);
+    req.method.assign(_buf + _method.off, _method.len);
+    req.version.assign(_buf + _version.off, _version.len);
+
+    std::string_view target = view(_target);
+    size_t q = target.find('?');
+    req.path.assign(target.substr(0, q));
+    req.query.clear();
+    if (q != std::string_view::npos)
+        req.query.assign(target.substr(q + 1));
+
+    // alle Header in einen Puffer: zwei Allokationen statt zwei Strings + Map-Knoten pro Header
+    req.headers.clear();
+    req.headers.reserve(_nheaders, _pos);
+    for (size_t i = 0; i < _nheaders; ++i)
+    {
+        std::string_view key = view(_headers[i].name);
+        std::string_view value = view(_headers[i].value);
+        if (headerId(key) == H_COOKIE)
+            parseCookieHeader(std::string(value), req.cookies);
+        else
+            req.headers.add(key, value);
+    }
 
-    if (key == "Cookie")
-        req.cookies = parseCookieHeader(value);
+    // Connection / keep-alive logic (Header-Name und Token case-insensitive)
+    std::string_view conn = req.headers.get(H_CONNECTION);
+    if (req.version == "HTTP/1.1")
+        req.keep_alive = !hasToken(conn, "close");
     else
-        req.headers[key] = value;
+        req.keep_alive = hasToken(conn, "keep-alive");
+
+    // Transfer-Encoding / Content-Length
+    req.is_chunked = false;
+    req.content_len = 0;
+    if (req.headers.has(H_TRANSFER_ENCODING))
+    {
+        std::string_view te = req.headers.get(H_TRANSFER_ENCODING);
+        if (te.size() != 7 || strncasecmp(te.data(), "chunked", 7) != 0)
+            return false;
+        req.is_chunked = true;
+    }
+    else if (req.headers.has(H_CONTENT_LENGTH))
+    {
+        std::string cl(req.headers.get(H_CONTENT_LENGTH));
+        if (cl.empty() || cl.find_first_not_of("0123456789") != std::string::npos || cl.size() > 18)
+            return false;
+        req.content_len = std::strtoull(cl.c_str(), NULL, 10);
+    }
+    return true;
 }
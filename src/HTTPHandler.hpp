@@ -6,7 +6,7 @@
 /*   By: leokubler <leokubler@student.42.fr>        +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:24 by mhummel           #+#    #+#             */
-/*   Updated: 2025/11/12 11:52:09 by leokubler        ###   ########.fr       */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -15,10 +15,21 @@
 
 #include <string>
 #include <map>
+#include <string_view>
+#include <memory_resource>
+#include <stdint.h>
 #include "config.hpp"
+#include "Headers.hpp"
+#include "RequestBody.hpp"
 
+// Strings und Header liegen in der übergebenen memory_resource (im Server:
+// Arena der Verbindung, mit dem Request auf einmal freigegeben). Der Body
+// bleibt auf dem Heap bzw. in der Temp-Datei.
 struct Request
 {
+	explicit Request(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+		: method(mr), path(mr), version(mr), query(mr), cookies(mr), headers(mr) {}
+
 	// Verbindungsdaten
 	bool keep_alive = false; // aus Version+Header abgeleitet
 	int conn_fd = -1; // -1 heist, keine verbindung
@@ -26,25 +37,63 @@ struct Request
 	// Request-Daten
 	bool is_chunked = false;
 	size_t content_len = 0;
-	std::string method;
-	std::string path;
-	std::string version;
-	std::string query;
-	std::map<std::string, std::string> cookies;
-	std::map<std::string, std::string> headers;
-	std::string body;
+	std::pmr::string method;
+	std::pmr::string path;
+	std::pmr::string version;
+	std::pmr::string query;
+	std::pmr::map<std::pmr::string, std::pmr::string> cookies;
+	HeaderMap headers;  // case-insensitive, bekannte Header per HeaderId
+	RequestBody body;   // Speicher oder Temp-Datei, siehe RequestBody
 };
 
+// Resumable HTTP/1.1 Head-Parser (Request-Line + Header).
+// feed() bekommt bei jedem read den ganzen bisherigen Puffer und macht dort
+// weiter, wo er aufgehört hat. Gemerkt werden nur Offsets (kein Kopieren, keine
+// Allokation), Zugriff danach als string_view in den Puffer, solange dieser
+// nicht verändert wird.
 class RequestParser
 {
 	public:
+		enum Status { NEED_MORE, DONE, ERROR };
+		enum { MAX_HEADERS = 100, MAX_REQUEST_LINE = 8192 };
+
 		RequestParser();
 		~RequestParser();
 
-		Request parse(const std::string& rawRequest);
+		void   reset();
+		Status feed(const char* buf, size_t len, size_t max_header_bytes);
+		int    error() const { return _error; }        // HTTP-Status bei ERROR
+		size_t consumed() const { return _pos; }       // Länge des Heads inkl. Leerzeile
+
+		std::string_view method() const  { return view(_method); }
+		std::string_view target() const  { return view(_target); }
+		std::string_view version() const { return view(_version); }
+		size_t           headerCount() const { return _nheaders; }
+		std::string_view headerName(size_t i) const  { return view(_headers[i].name); }
+		std::string_view headerValue(size_t i) const { return view(_headers[i].value); }
+		// erster Header mit diesem Namen (case-insensitive), leer wenn keiner
+		std::string_view header(std::string_view name, bool* found = NULL) const;
+
+		// Request-Struct aus dem geparsten Head füllen (ohne Body)
+		bool build(Request& req) const;
 
 	private:
-		void parseRequestLine(const std::string& line, Request& req);
-		void parseHeaderLine(const std::string& line, Request& req);
+		struct Span { uint32_t off, len; };
+		struct Field { Span name, value; };
+		enum State { S_START, S_METHOD, S_TARGET, S_VERSION, S_RL_LF,
+		             S_HDR_START, S_NAME, S_OWS, S_VALUE, S_HDR_LF, S_END_LF, S_DONE };
+
+		std::string_view view(Span s) const { return std::string_view(_buf + s.off, s.len); }
+		Status fail(int code) { _error = code; _state = S_DONE; return ERROR; }
+
+		const char* _buf;
+		size_t      _pos;
+		State       _state;
+		int         _error;
+		size_t      _mark;         // Beginn des aktuellen Tokens
+		size_t      _value_end;    // Ende des Werts ohne trailing Whitespace
+		Span        _method, _target, _version;
+		Field       _headers[MAX_HEADERS];
+		size_t      _nheaders;
 };
 #endif
@@ -0,0 +1,152 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Headers.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:51:10 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:51:10 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Headers.hpp"
+#include <strings.h>
+#include <cstring>
+
+static const char* const kNames[H_COUNT] = {
+	"",
+	"Host", "Connection", "Content-Length", "Content-Type", "Transfer-Encoding",
+	"Cookie", "Accept-Encoding", "Range", "If-Range", "If-None-Match",
+	"If-Modified-Since", "Expect", "Keep-Alive", "Server", "ETag",
+	"Last-Modified", "Content-Encoding", "Content-Range", "Accept-Ranges", "Vary",
+	"X-Cache", "Location", "Set-Cookie", "Allow", "Date",
+	"User-Agent", "Accept", "Upgrade",
+};
+
+// (len + lower(erstes)*7 + lower(letztes)*39) & 63 ist für alle Namen oben
+// kollisionsfrei; ein anderer Name landet auf H_OTHER oder fällt beim
+// Vergleich durch
+static const uint8_t kSlots[64] = {
+	H_OTHER, H_CONNECTION, H_OTHER, H_OTHER,
+	H_IF_NONE_MATCH, H_OTHER, H_RANGE, H_OTHER,
+	H_HOST, H_SERVER, H_IF_RANGE, H_OTHER,
+	H_OTHER, H_ALLOW, H_OTHER, H_OTHER,
+	H_OTHER, H_OTHER, H_SET_COOKIE, H_IF_MODIFIED_SINCE,
+	H_OTHER, H_OTHER, H_OTHER, H_OTHER,
+	H_OTHER, H_ACCEPT, H_KEEP_ALIVE, H_CONTENT_LENGTH,
+	H_OTHER, H_UPGRADE, H_COOKIE, H_OTHER,
+	H_OTHER, H_OTHER, H_OTHER, H_DATE,
+	H_CONTENT_TYPE, H_CONTENT_RANGE, H_OTHER, H_ACCEPT_ENCODING,
+	H_OTHER, H_USER_AGENT, H_OTHER, H_OTHER,
+	H_OTHER, H_VARY, H_TRANSFER_ENCODING, H_OTHER,
+	H_OTHER, H_OTHER, H_X_CACHE, H_OTHER,
+	H_OTHER, H_EXPECT, H_CONTENT_ENCODING, H_OTHER,
+	H_ETAG, H_ACCEPT_RANGES, H_OTHER, H_OTHER,
+	H_OTHER, H_LAST_MODIFIED, H_LOCATION, H_OTHER,
+};
+
+HeaderId headerId(std::string_view name)
+{
+	if (name.empty()) return H_OTHER;
+	unsigned h = (unsigned)name.size() + ((unsigned char)name[0] | 0x20) * 7
+				 + ((unsigned char)name[name.size() - 1] | 0x20) * 39;
+	HeaderId id = (HeaderId)kSlots[h & 63];
+	if (id != H_OTHER && (name.size() != strlen(kNames[id])
+						  || strncasecmp(name.data(), kNames[id], name.size()) != 0))
+		return H_OTHER;
+	return id;
+}
+
+const char* headerName(HeaderId id)
+{
+	return (id > H_OTHER && id < H_COUNT) ? kNames[id] : "";
+}
+
+void HeaderMap::reserve(size_t fields, size_t bytes)
+{
+	_fields.reserve(fields);
+	_buf.reserve(bytes);
+}
+
+uint32_t HeaderMap::store(std::string_view s)
+{
+	uint32_t off = (uint32_t)_buf.size();
+	_buf.append(s.data(), s.size());
+	return off;
+}
+
+void HeaderMap::add(std::string_view name, std::string_view value)
+{
+	Field f;
+	f.id        = (uint8_t)headerId(name);
+	f.name_len  = (uint16_t)name.size();
+	f.name_off  = store(name);
+	f.value_len = (uint32_t)value.size();
+	f.value_off = store(value);
+	_fields.push_back(f);
+}
+
+void HeaderMap::set(HeaderId id, std::string_view value)
+{
+	long i = find(id);
+	if (i < 0) { add(headerName(id), value); return; }
+	// alter Wert bleibt als toter Bereich im Puffer – Header werden selten überschrieben
+	_fields[i].value_len = (uint32_t)value.size();
+	_fields[i].value_off = store(value);
+}
+
+void HeaderMap::set(std::string_view name, std::string_view value)
+{
+	HeaderId id = headerId(name);
+	if (id != H_OTHER) { set(id, value); return; }
+	long i = find(name);
+	if (i < 0) { add(name, value); return; }
+	_fields[i].value_len = (uint32_t)value.size();
+	_fields[i].value_off = store(value);
+}
+
+void HeaderMap::erase(HeaderId id)
+{
+	for (size_t i = 0; i < _fields.size(); )
+		if (_fields[i].id == id) _fields.erase(_fields.begin() + i);
+		else ++i;
+}
+
+long HeaderMap::find(HeaderId id) const
+{
+	for (size_t i = 0; i < _fields.size(); ++i)
+		if (_fields[i].id == id) return (long)i;
+	return -1;
+}
+
+long HeaderMap::find(std::string_view name) const
+{
+	HeaderId id = headerId(name);
+	if (id != H_OTHER) return find(id);
+	for (size_t i = 0; i < _fields.size(); ++i)
+		if (_fields[i].id == H_OTHER && _fields[i].name_len == name.size()
+			&& strncasecmp(_buf.data() + _fields[i].name_off, name.data(), name.size()) == 0)
+			return (long)i;
+	return -1;
+}
+
+std::string_view HeaderMap::get(HeaderId id) const
+{
+	long i = find(id);
+	return i < 0 ? std::string_view() : value(i);
+}
+
+std::string_view HeaderMap::get(std::string_view name) const
+{
+	long i = find(name);
+	return i < 0 ? std::string_view() : value(i);
+}
+
+size_t HeaderMap::bytes() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < _fields.size(); ++i)
+		n += _fields[i].name_len + _fields[i].value_len;
+	return n;
+}
@@ -0,0 +1,95 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Headers.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:51:10 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef HEADERS_HPP
+# define HEADERS_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <stdint.h>
+
+// Header, die der Server selbst liest oder schreibt. headerId() findet sie
+// über eine perfekte Hash-Tabelle (Länge + erstes + letztes Zeichen), ein
+// Vergleich bestätigt den Treffer – alles andere ist H_OTHER.
+enum HeaderId
+{
+	H_OTHER = 0,
+	H_HOST, H_CONNECTION, H_CONTENT_LENGTH, H_CONTENT_TYPE, H_TRANSFER_ENCODING,
+	H_COOKIE, H_ACCEPT_ENCODING, H_RANGE, H_IF_RANGE, H_IF_NONE_MATCH,
+	H_IF_MODIFIED_SINCE, H_EXPECT, H_KEEP_ALIVE, H_SERVER, H_ETAG,
+	H_LAST_MODIFIED, H_CONTENT_ENCODING, H_CONTENT_RANGE, H_ACCEPT_RANGES, H_VARY,
+	H_X_CACHE, H_LOCATION, H_SET_COOKIE, H_ALLOW, H_DATE,
+	H_USER_AGENT, H_ACCEPT, H_UPGRADE,
+	H_COUNT
+};
+
+HeaderId    headerId(std::string_view name);   // case-insensitive
+const char* headerName(HeaderId id);          // kanonische Schreibweise
+
+// Kompakte Header-Liste für Request und Response: Namen und Werte liegen
+// hintereinander in einem Puffer, die Felder sind nur Offsets + HeaderId.
+// Statt zwei Strings und einem Map-Knoten pro Header gibt es zwei
+// Allokationen für alle. Suche ist case-insensitive; bekannte Header
+// werden per Id verglichen. Beide Puffer kommen aus der übergebenen
+// memory_resource (im Server: Arena der Verbindung).
+class HeaderMap
+{
+	public:
+		explicit HeaderMap(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+			: _fields(mr), _buf(mr) {}
+
+		std::pmr::memory_resource* resource() const { return _fields.get_allocator().resource(); }
+
+		void reserve(size_t fields, size_t bytes);
+		void clear() { _fields.clear(); _buf.clear(); }
+
+		// hängt an (Request: doppelte Header bleiben erhalten)
+		void add(std::string_view name, std::string_view value);
+		// ersetzt den ersten Header mit diesem Namen oder hängt an
+		void set(HeaderId id, std::string_view value);
+		void set(std::string_view name, std::string_view value);
+		void erase(HeaderId id);
+
+		bool has(HeaderId id) const { return find(id) >= 0; }
+		bool has(std::string_view name) const { return find(name) >= 0; }
+		// Wert des ersten Treffers, leer wenn nicht vorhanden
+		std::string_view get(HeaderId id) const;
+		std::string_view get(std::string_view name) const;
+
+		size_t           size() const { return _fields.size(); }
+		bool             empty() const { return _fields.empty(); }
+		std::string_view name(size_t i) const  { return span(_fields[i].name_off, _fields[i].name_len); }
+		std::string_view value(size_t i) const { return span(_fields[i].value_off, _fields[i].value_len); }
+		size_t           bytes() const;   // Summe aus Namen und Werten (für reserve beim Serialisieren)
+
+	private:
+		struct Field
+		{
+			uint8_t  id;
+			uint16_t name_len;
+			uint32_t name_off;
+			uint32_t value_off;
+			uint32_t value_len;
+		};
+
+		long find(HeaderId id) const;
+		long find(std::string_view name) const;
+		uint32_t store(std::string_view s);
+		std::string_view span(uint32_t off, uint32_t len) const { return std::string_view(_buf.data() + off, len); }
+
+		std::pmr::vector<Field> _fields;
+		std::pmr::string        _buf;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationPolicy.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:48:58 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "LocationPolicy.hpp"
+#include "config.hpp"
+#include "CGIHandler.hpp"
+#include <iostream>
+
+static const struct { const char* name; unsigned bit; } kMethods[] = {
+	{ "GET",     METHOD_GET },
+	{ "HEAD",    METHOD_HEAD },
+	{ "POST",    METHOD_POST },
+	{ "PUT",     METHOD_PUT },
+	{ "DELETE",  METHOD_DELETE },
+	{ "OPTIONS", METHOD_OPTIONS },
+	{ "PATCH",   METHOD_PATCH },
+};
+
+unsigned methodBit(std::string_view method)
+{
+	for (size_t i = 0; i < sizeof(kMethods) / sizeof(kMethods[0]); ++i)
+		if (method == kMethods[i].name)
+			return kMethods[i].bit;
+	return 0;
+}
+
+// doppelte Slashes weg, kein '/' am Ende (außer "/" selbst)
+static std::string canonical(const std::string& p)
+{
+	std::string out;
+	out.reserve(p.size());
+	for (size_t i = 0; i < p.size(); ++i)
+		if (p[i] != '/' || out.empty() || out[out.size() - 1] != '/')
+			out += p[i];
+	if (out.size() > 1 && out[out.size() - 1] == '/')
+		out.erase(out.size() - 1);
+	return out;
+}
+
+std::shared_ptr<const LocationPolicy> LocationPolicy::compile(const ServerConfig& sc, const LocationConfig& lc)
+{
+	std::shared_ptr<LocationPolicy> p = std::make_shared<LocationPolicy>();
+
+	p->methods = 0;
+	for (size_t i = 0; i < lc.methods.size(); ++i)
+	{
+		unsigned bit = methodBit(lc.methods[i]);
+		if (!bit)
+		{
+			std::cerr << "Warnung: unbekannte Methode " << lc.methods[i] << " in location " << lc.path << "\n";
+			continue;
+		}
+		if (p->methods & bit) continue;
+		p->methods |= bit;
+		if (!p->allow.empty()) p->allow += ", ";
+		p->allow += lc.methods[i];
+	}
+
+	p->prefix = canonical(lc.path);
+	if (p->prefix == "/") p->prefix.clear();
+	p->root = canonical(lc.root.empty() ? "." : lc.root);
+	p->index = lc.index.empty() ? "index.html" : lc.index;
+	p->root_index = (p->root == "/" ? "" : p->root) + "/" + p->index;
+	p->data_dir = lc.data_dir.empty() ? "./data" : lc.data_dir;
+	p->cgi = lc.cgi;
+	p->cgi_env = CGIHandler::staticEnv(sc);
+	return p;
+}
+
+const std::string* LocationPolicy::cgiFor(std::string_view path) const
+{
+	if (cgi.empty()) return NULL;
+	size_t dot = path.find_last_of("./");
+	if (dot == std::string_view::npos || path[dot] != '.') return NULL;
+	std::map<std::string, std::string>::const_iterator it = cgi.find(std::string(path.substr(dot)));
+	return it == cgi.end() ? NULL : &it->second;
+}
+
+std::string LocationPolicy::map(const std::string& url) const
+{
+	std::string rest = url;
+	if (!prefix.empty() && rest.compare(0, prefix.size(), prefix) == 0)
+		rest.erase(0, prefix.size());
+	if (rest.empty() || rest == "/")
+		return root;
+	if (rest[0] != '/') rest.insert(0, "/");
+	return (root == "/" ? "" : root) + rest;
+}
@@ -0,0 +1,63 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationPolicy.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:48:58 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOCATIONPOLICY_HPP
+# define LOCATIONPOLICY_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+
+struct LocationConfig;
+struct ServerConfig;
+
+// Methoden als Bits, damit "darf das?" ein AND ist statt eines String-Vergleichs
+enum MethodBit
+{
+	METHOD_GET     = 1 << 0,
+	METHOD_HEAD    = 1 << 1,
+	METHOD_POST    = 1 << 2,
+	METHOD_PUT     = 1 << 3,
+	METHOD_DELETE  = 1 << 4,
+	METHOD_OPTIONS = 1 << 5,
+	METHOD_PATCH   = 1 << 6
+};
+
+unsigned methodBit(std::string_view method);   // 0 = unbekannt
+
+// Alles, was ein Request von seiner Location braucht, einmal beim Start
+// aus der LocationConfig kompiliert und danach nur noch gelesen: keine
+// String-Joins für Root/Index pro Request, Methoden als Bitmaske.
+struct LocationPolicy
+{
+	unsigned    methods;      // erlaubte Methoden (MethodBit)
+	std::string allow;        // fertiger Wert für den "Allow"-Header
+	std::string prefix;       // Location-Pfad, der vor dem Mappen abgeschnitten wird ("" bei "/")
+	std::string root;         // kanonisch: ohne doppelte und abschließende '/', nie leer
+	std::string index;        // Name der Index-Datei
+	std::string root_index;   // root + "/" + index
+	std::string data_dir;     // Ziel für POST-Uploads und DELETE
+	std::map<std::string, std::string> cgi;   // Endung -> Interpreter (oder fastcgi://...)
+	std::vector<std::string> cgi_env;        // feste CGI-Variablen ("NAME=wert")
+
+	bool allows(std::string_view method) const { return (methods & methodBit(method)) != 0; }
+	// Interpreter für ein CGI-Script, NULL = kein CGI in dieser Location
+	const std::string* cgiFor(std::string_view path) const;
+	// normalisierte URL -> Pfad im Dateisystem
+	std::string map(const std::string& url) const;
+
+	static std::shared_ptr<const LocationPolicy> compile(const ServerConfig& sc, const LocationConfig& lc);
+};
+
+#endif
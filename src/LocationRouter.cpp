@@ -0,0 +1,71 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationRouter.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:47:14 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:47:14 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "LocationRouter.hpp"
+#include "config.hpp"
+
+LocationRouter::LocationRouter() : _nodes(1), _fallback(0) {}
+
+// nächstes Segment ab pos (leere Segmente durch "//" werden übersprungen)
+static bool nextSegment(const std::string& path, size_t& pos, size_t& start, size_t& len)
+{
+	while (pos < path.size() && path[pos] == '/') ++pos;
+	if (pos >= path.size()) return false;
+	start = pos;
+	while (pos < path.size() && path[pos] != '/') ++pos;
+	len = pos - start;
+	return true;
+}
+
+void LocationRouter::build(const std::vector<LocationConfig>& locations)
+{
+	_nodes.assign(1, Node());
+	_fallback = 0;
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		const std::string& p = locations[i].path;
+		if (p.empty()) continue;
+		size_t node = 0, pos = 0, start, len;
+		while (nextSegment(p, pos, start, len))
+		{
+			std::string seg = p.substr(start, len);
+			std::unordered_map<std::string, size_t>::iterator it = _nodes[node].next.find(seg);
+			if (it == _nodes[node].next.end())
+			{
+				_nodes.push_back(Node());
+				it = _nodes[node].next.insert(std::make_pair(seg, _nodes.size() - 1)).first;
+			}
+			node = it->second;
+		}
+		// doppelte Location: die erste gewinnt, wie beim linearen Scan
+		if (_nodes[node].loc < 0)
+			_nodes[node].loc = (long)i;
+	}
+	if (_nodes[0].loc >= 0)
+		_fallback = (size_t)_nodes[0].loc;
+}
+
+size_t LocationRouter::match(const std::string& path) const
+{
+	long best = _nodes[0].loc;
+	size_t node = 0, pos = 0, start, len;
+	std::string seg;
+	while (nextSegment(path, pos, start, len))
+	{
+		seg.assign(path, start, len);
+		std::unordered_map<std::string, size_t>::const_iterator it = _nodes[node].next.find(seg);
+		if (it == _nodes[node].next.end()) break;
+		node = it->second;
+		if (_nodes[node].loc >= 0) best = _nodes[node].loc;
+	}
+	return best >= 0 ? (size_t)best : _fallback;
+}
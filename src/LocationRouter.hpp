@@ -0,0 +1,49 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationRouter.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:47:14 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:47:14 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOCATIONROUTER_HPP
+# define LOCATIONROUTER_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+struct LocationConfig;
+
+// Locations eines Server-Blocks als Trie über die Pfad-Segmente, einmal
+// beim Laden der Config gebaut. Ein Request läuft den Pfad nur einmal ab,
+// statt alle Locations mit compare() zu vergleichen, und "/cgi" passt
+// nicht mehr auf "/cgi-bin/x" – nur ganze Segmente zählen.
+class LocationRouter
+{
+	public:
+		LocationRouter();
+
+		void build(const std::vector<LocationConfig>& locations);
+		// Index der längsten passenden Location; ohne Treffer die "/"-Location,
+		// sonst die erste (wie bisher)
+		size_t match(const std::string& path) const;
+
+	private:
+		struct Node
+		{
+			std::unordered_map<std::string, size_t> next;   // Segment -> Node-Index
+			long loc;                                        // Location-Index oder -1
+			Node() : loc(-1) {}
+		};
+
+		std::vector<Node> _nodes;   // [0] = Wurzel ("/")
+		size_t            _fallback;
+};
+
+#endif
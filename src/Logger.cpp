@@ -0,0 +1,226 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Logger.cpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 04:06:55 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// so oft sammelt der Schreib-Thread ein; kürzer = mehr write()s
+static const int FLUSH_MS = 50;
+
+Logger& Logger::get()
+{
+	static Logger log;
+	return log;
+}
+
+Logger::Logger()
+	: _ring(new Slot[SLOTS]), _head(0), _tail(0), _dropped(0), _reported(0),
+	  _level(LogLevel::INFO), _error_fd(2), _access_fd(-1), _format(COMBINED),
+	  _stop(false), _users(0)
+{
+	for (size_t i = 0; i < SLOTS; ++i)
+		_ring[i].seq.store(i, std::memory_order_relaxed);
+}
+
+Logger::~Logger()
+{
+	_stop.store(true, std::memory_order_release);
+	if (_thread.joinable()) _thread.join();
+	else run();   // nie gestartet (z. B. nur Master-Prozess): Rest direkt schreiben
+	if (_error_fd > 2) ::close(_error_fd);
+	if (_access_fd > 2) ::close(_access_fd);
+	delete[] _ring;
+}
+
+static int open_log(const std::string& path)
+{
+	return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+bool Logger::configure(const std::string& error_path, LogLevel level,
+					   const std::string& access_path, AccessFormat format)
+{
+	bool ok = true;
+	_level  = level;
+	_format = format;
+	if (!error_path.empty()) {
+		int fd = open_log(error_path);
+		if (fd >= 0) _error_fd = fd;
+		else ok = false;   // bleibt auf stderr
+	}
+	if (!access_path.empty()) {
+		_access_fd = open_log(access_path);
+		if (_access_fd < 0) ok = false;
+	}
+	return ok;
+}
+
+void Logger::start()
+{
+	std::lock_guard<std::mutex> lock(_life);
+	if (_users++ > 0) return;
+	_stop.store(false);
+	_thread = std::thread(&Logger::run, this);
+}
+
+void Logger::stop()
+{
+	std::lock_guard<std::mutex> lock(_life);
+	if (_users == 0 || --_users > 0) return;
+	_stop.store(true, std::memory_order_release);
+	if (_thread.joinable()) _thread.join();
+}
+
+// Platz im Ring reservieren (CAS auf _head), füllen, per seq freigeben.
+// seq == pos: frei; seq == pos + 1: gefüllt; voll, wenn seq noch eine Runde zurück liegt
+void Logger::push(Kind k, LogLevel l, const char* data, size_t len, size_t split)
+{
+	size_t pos = _head.load(std::memory_order_relaxed);
+	Slot*  s;
+	for (;;)
+	{
+		s = &_ring[pos & (SLOTS - 1)];
+		size_t   seq = s->seq.load(std::memory_order_acquire);
+		intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+		if (dif == 0) {
+			if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (dif < 0) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+			pos = _head.load(std::memory_order_relaxed);
+	}
+	len = std::min(len, (size_t)LINE_MAX);
+	s->t     = ::time(NULL);
+	s->kind  = (uint8_t)k;
+	s->level = (uint8_t)l;
+	s->split = (uint16_t)std::min(split, len);
+	s->len   = (uint16_t)len;
+	std::memcpy(s->data, data, len);
+	s->seq.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::message(LogLevel l, const char* text, size_t len)
+{
+	if (enabled(l))
+		push(K_ERROR, l, text, len, 0);
+}
+
+void Logger::access(const std::string& line, size_t split)
+{
+	if (_access_fd >= 0)
+		push(K_ACCESS, LogLevel::INFO, line.data(), line.size(), split);
+}
+
+// Zeitstempel nur einmal pro Sekunde formatieren
+static const char* stamp(time_t t, int which)
+{
+	static const char* fmts[] = { "%Y/%m/%d %H:%M:%S", "%d/%b/%Y:%H:%M:%S %z", "%Y-%m-%dT%H:%M:%S%z" };
+	static time_t last[3] = { -1, -1, -1 };
+	static char   buf[3][40];
+	if (t != last[which]) {
+		struct tm tm;
+		localtime_r(&t, &tm);
+		strftime(buf[which], sizeof(buf[which]), fmts[which], &tm);
+		last[which] = t;
+	}
+	return buf[which];
+}
+
+// alles Gefüllte aus dem Ring in die beiden Puffer; false = Ring war leer
+bool Logger::drain(std::string& err, std::string& acc)
+{
+	static const char* names[] = { "debug", "info", "warn", "error" };
+	bool any = false;
+	for (;;)
+	{
+		Slot& s = _ring[_tail & (SLOTS - 1)];
+		if (s.seq.load(std::memory_order_acquire) != _tail + 1)
+			break;
+		if (s.kind == K_ACCESS) {
+			acc.append(s.data, s.split);
+			acc += stamp(s.t, _format == JSON ? 2 : 1);
+			acc.append(s.data + s.split, s.len - s.split);
+			acc += '\n';
+		} else {
+			err += stamp(s.t, 0);
+			err += " [";
+			err += names[s.level];
+			err += "] ";
+			err += std::to_string(::getpid());
+			err += ": ";
+			err.append(s.data, s.len);
+			if (s.len == 0 || s.data[s.len - 1] != '\n') err += '\n';
+		}
+		s.seq.store(_tail + SLOTS, std::memory_order_release);
+		++_tail;
+		any = true;
+	}
+	return any;
+}
+
+static void write_all(int fd, const std::string& s)
+{
+	size_t off = 0;
+	while (off < s.size())
+	{
+		ssize_t n = ::write(fd, s.data() + off, s.size() - off);
+		if (n > 0) { off += n; continue; }
+		if (n < 0 && errno == EINTR) continue;
+		break;   // Log-Platte voll o.ä.: verwerfen, der Server läuft weiter
+	}
+}
+
+void Logger::run()
+{
+	std::string err, acc;
+	for (;;)
+	{
+		bool last = _stop.load(std::memory_order_acquire);
+		drain(err, acc);
+		uint64_t d = dropped();
+		if (d != _reported) {
+			err += stamp(::time(NULL), 0);
+			err += " [warn] " + std::to_string(::getpid()) + ": log ring full, "
+				 + std::to_string(d - _reported) + " lines dropped\n";
+			_reported = d;
+		}
+		if (!err.empty()) write_all(_error_fd, err);
+		if (!acc.empty()) write_all(_access_fd, acc);
+		err.clear();
+		acc.clear();
+		if (last) break;   // nach dem Stop-Signal noch einmal komplett geleert
+		::usleep(FLUSH_MS * 1000);
+	}
+}
+
+void logMsg(LogLevel level, const char* fmt, ...)
+{
+	Logger& log = Logger::get();
+	if (!log.enabled(level)) return;
+	char    buf[Logger::LINE_MAX];
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (n < 0) return;
+	log.message(level, buf, std::min((size_t)n, sizeof(buf) - 1));
+}
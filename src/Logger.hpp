@@ -0,0 +1,98 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Logger.hpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 04:06:07 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOGGER_HPP
+# define LOGGER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+enum class LogLevel { DEBUG, INFO, WARN, ERROR };
+
+// Error- und Access-Log ohne Syscall im Event-Loop: Producer (Worker-Threads)
+// kopieren die fertige Zeile in einen lock-freien Ring (Vyukov, bounded
+// MPSC), ein Hintergrund-Thread pro Prozess sammelt alle paar ms ein und
+// schreibt pro Datei einen write(). Ist der Ring voll, wird die Zeile
+// verworfen und gezählt statt den Worker zu blockieren.
+// Den Zeitstempel setzt der Schreib-Thread ein (Producer speichern nur time_t).
+class Logger
+{
+	public:
+		enum AccessFormat { COMBINED, JSON };
+		enum { SLOTS = 2048, LINE_MAX = 1000 };   // längere Zeilen werden gekürzt
+
+		static Logger& get();
+
+		// aus der Config, vor start(); Pfad leer = stderr bzw. kein Access-Log
+		bool configure(const std::string& error_path, LogLevel level,
+					   const std::string& access_path, AccessFormat format);
+		// Schreib-Thread starten/stoppen; mehrfach aufrufbar (ein Thread pro
+		// Prozess, der letzte stop() schreibt den Rest und beendet ihn)
+		void start();
+		void stop();
+
+		bool enabled(LogLevel l) const { return l >= _level; }
+		void message(LogLevel l, const char* text, size_t len);
+
+		bool         accessOn() const { return _access_fd >= 0; }
+		AccessFormat accessFormat() const { return _format; }
+		// fertige Access-Zeile ohne Zeit und Newline; an split wird die Zeit eingesetzt
+		void access(const std::string& line, size_t split);
+
+		uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+	private:
+		enum Kind { K_ERROR, K_ACCESS };
+		struct Slot
+		{
+			std::atomic<size_t> seq;
+			time_t   t;
+			uint8_t  kind;
+			uint8_t  level;
+			uint16_t split;
+			uint16_t len;
+			char     data[LINE_MAX];
+		};
+
+		Logger();
+		~Logger();
+		Logger(const Logger&);
+		Logger& operator=(const Logger&);
+
+		void push(Kind k, LogLevel l, const char* data, size_t len, size_t split);
+		void run();
+		bool drain(std::string& err, std::string& acc);
+
+		Slot*                 _ring;
+		std::atomic<size_t>   _head;     // nächster freier Platz (Producer)
+		size_t                _tail;     // nächster zu lesender Platz (nur Schreib-Thread)
+		std::atomic<uint64_t> _dropped;
+		uint64_t              _reported; // davon schon im Error-Log gemeldet
+		LogLevel              _level;
+		int                   _error_fd;
+		int                   _access_fd;
+		AccessFormat          _format;
+		std::mutex            _life;     // nur start()/stop()
+		std::thread           _thread;
+		std::atomic<bool>     _stop;
+		int                   _users;
+};
+
+// Error-Log im printf-Stil: logMsg(LogLevel::WARN, "accept: %s", strerror(errno))
+void logMsg(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
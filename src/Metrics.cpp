@@ -0,0 +1,197 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Metrics.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 04:12:06 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:16:31 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Metrics.hpp"
+#include "LocationPolicy.hpp"
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <new>
+
+static WorkerMetrics* g_slots = NULL;
+static int            g_count = 0;
+
+// ---- LatencyHist ----------------------------------------------------------
+
+size_t LatencyHist::index(uint64_t us)
+{
+	if (us < (uint64_t)LINEAR) return (size_t)us;
+	int k = 63 - __builtin_clzll(us);   // Zweierpotenz
+	if (k > MAX_EXP) return BUCKETS - 1;
+	size_t sub = (us >> (k - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+	return LINEAR + (size_t)(k - SUB_BITS - 1) * (1 << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHist::upper(size_t i)
+{
+	if (i < (size_t)LINEAR) return i;
+	if (i >= (size_t)BUCKETS - 1) return UINT64_MAX;
+	size_t j   = i - LINEAR;
+	int    k   = (int)(j >> SUB_BITS) + SUB_BITS + 1;
+	size_t sub = j & ((1 << SUB_BITS) - 1);
+	return (((uint64_t)(1 << SUB_BITS) + sub + 1) << (k - SUB_BITS)) - 1;
+}
+
+void LatencyHist::record(uint64_t us)
+{
+	WorkerMetrics::add(bucket[index(us)]);
+	WorkerMetrics::add(sum_us, us);
+}
+
+// ---- WorkerMetrics --------------------------------------------------------
+
+void WorkerMetrics::request(std::string_view method, int status)
+{
+	unsigned bit = methodBit(method);
+	size_t   m   = bit ? (size_t)__builtin_ctz(bit) + 1 : (size_t)M_OTHER;   // Reihenfolge wie MethodBit
+	if (m >= M_COUNT) m = M_OTHER;
+	if (status < STATUS_MIN || status > STATUS_MAX) return;
+	add(requests[m][status - STATUS_MIN]);
+}
+
+// ---- Metrics --------------------------------------------------------------
+
+bool Metrics::init(int workers)
+{
+	if (workers < 1) workers = 1;
+	size_t len = sizeof(WorkerMetrics) * (size_t)workers;
+	void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) return false;
+	g_slots = static_cast<WorkerMetrics*>(p);
+	for (int i = 0; i < workers; ++i)
+		new (g_slots + i) WorkerMetrics();
+	g_count = workers;
+	return true;
+}
+
+WorkerMetrics& Metrics::slot(int worker)
+{
+	static WorkerMetrics fallback;   // ohne init(): nur dieser Prozess zählt
+	if (worker >= 0 && worker < g_count) return g_slots[worker];
+	return fallback;
+}
+
+// Summen über alle Slots (relaxed gelesen: ein Scrape ist eine Momentaufnahme)
+struct Totals
+{
+	uint64_t accepted, closed, bytes_in, bytes_out, cgi_spawns, fastcgi_requests, cache_hits, cache_misses;
+	uint64_t timeouts[WorkerMetrics::TIMEOUT_PHASES];
+	uint64_t requests[WorkerMetrics::M_COUNT][WorkerMetrics::STATUS_MAX - WorkerMetrics::STATUS_MIN + 1];
+	uint64_t bucket[WorkerMetrics::P_COUNT][LatencyHist::BUCKETS];
+	uint64_t sum_us[WorkerMetrics::P_COUNT];
+};
+
+static void sum(Totals& t, const WorkerMetrics& w)
+{
+	const std::memory_order r = std::memory_order_relaxed;
+	t.accepted += w.accepted.load(r);
+	t.closed += w.closed.load(r);
+	t.bytes_in += w.bytes_in.load(r);
+	t.bytes_out += w.bytes_out.load(r);
+	t.cgi_spawns += w.cgi_spawns.load(r);
+	t.fastcgi_requests += w.fastcgi_requests.load(r);
+	t.cache_hits += w.cache_hits.load(r);
+	t.cache_misses += w.cache_misses.load(r);
+	for (int i = 0; i < WorkerMetrics::TIMEOUT_PHASES; ++i)
+		t.timeouts[i] += w.timeouts[i].load(r);
+	for (int m = 0; m < WorkerMetrics::M_COUNT; ++m)
+		for (int s = 0; s <= WorkerMetrics::STATUS_MAX - WorkerMetrics::STATUS_MIN; ++s)
+			t.requests[m][s] += w.requests[m][s].load(r);
+	for (int p = 0; p < WorkerMetrics::P_COUNT; ++p) {
+		for (int b = 0; b < LatencyHist::BUCKETS; ++b)
+			t.bucket[p][b] += w.latency[p].bucket[b].load(r);
+		t.sum_us[p] += w.latency[p].sum_us.load(r);
+	}
+}
+
+static void line(std::string& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static void line(std::string& out, const char* fmt, ...)
+{
+	char    buf[256];
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (n > 0) out.append(buf, std::min((size_t)n, sizeof(buf) - 1));
+	out += '\n';
+}
+
+static void header(std::string& out, const char* name, const char* type, const char* help)
+{
+	line(out, "# HELP %s %s", name, help);
+	line(out, "# TYPE %s %s", name, type);
+}
+
+static void counter(std::string& out, const char* name, const char* help, uint64_t v)
+{
+	header(out, name, "counter", help);
+	line(out, "%s %llu", name, (unsigned long long)v);
+}
+
+std::string Metrics::render()
+{
+	static const char* methods[] = { "OTHER", "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS", "PATCH" };
+	static const char* phases[]  = { "header", "handler", "write" };
+	static const char* tphases[] = { "none", "header", "body", "idle", "send", "cgi" };   // Server.hpp: Phase
+
+	Totals* t = new Totals();   // ~35 KB, nicht auf den Stack
+	WorkerMetrics& own = slot(-1);
+	if (g_count == 0) sum(*t, own);
+	for (int i = 0; i < g_count; ++i)
+		sum(*t, g_slots[i]);
+
+	std::string out;
+	out.reserve(16384);
+	counter(out, "webserv_connections_accepted_total", "Accepted client connections.", t->accepted);
+	counter(out, "webserv_connections_closed_total", "Closed client connections.", t->closed);
+	header(out, "webserv_connections_active", "gauge", "Currently open client connections.");
+	line(out, "webserv_connections_active %llu", (unsigned long long)(t->accepted - t->closed));
+
+	header(out, "webserv_requests_total", "counter", "Responses by request method and status code.");
+	for (int m = 0; m < WorkerMetrics::M_COUNT; ++m)
+		for (int s = 0; s <= WorkerMetrics::STATUS_MAX - WorkerMetrics::STATUS_MIN; ++s)
+			if (t->requests[m][s])
+				line(out, "webserv_requests_total{method=\"%s\",code=\"%d\"} %llu",
+					 methods[m], s + WorkerMetrics::STATUS_MIN, (unsigned long long)t->requests[m][s]);
+
+	counter(out, "webserv_received_bytes_total", "Bytes read from client sockets.", t->bytes_in);
+	counter(out, "webserv_sent_bytes_total", "Bytes written to client sockets.", t->bytes_out);
+	counter(out, "webserv_cgi_spawns_total", "CGI processes started.", t->cgi_spawns);
+	counter(out, "webserv_fastcgi_requests_total", "Requests passed to FastCGI upstreams.", t->fastcgi_requests);
+	counter(out, "webserv_response_cache_hits_total", "Responses served from the response cache.", t->cache_hits);
+	counter(out, "webserv_response_cache_misses_total", "Cacheable requests not found in the response cache.", t->cache_misses);
+
+	header(out, "webserv_timeouts_total", "counter", "Connection timeouts by phase.");
+	for (int i = 1; i < WorkerMetrics::TIMEOUT_PHASES; ++i)
+		line(out, "webserv_timeouts_total{phase=\"%s\"} %llu", tphases[i], (unsigned long long)t->timeouts[i]);
+
+	header(out, "webserv_phase_duration_seconds", "histogram",
+		   "Latency per request phase: header read, handler, write.");
+	for (int p = 0; p < WorkerMetrics::P_COUNT; ++p)
+	{
+		uint64_t cum = 0;
+		for (int b = 0; b < LatencyHist::BUCKETS; ++b)
+		{
+			cum += t->bucket[p][b];
+			if (b == LatencyHist::BUCKETS - 1)
+				line(out, "webserv_phase_duration_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu", phases[p], (unsigned long long)cum);
+			else
+				line(out, "webserv_phase_duration_seconds_bucket{phase=\"%s\",le=\"%.6f\"} %llu", phases[p],
+					 (double)LatencyHist::upper(b) / 1e6, (unsigned long long)cum);
+		}
+		line(out, "webserv_phase_duration_seconds_sum{phase=\"%s\"} %.6f", phases[p], (double)t->sum_us[p] / 1e6);
+		line(out, "webserv_phase_duration_seconds_count{phase=\"%s\"} %llu", phases[p], (unsigned long long)cum);
+	}
+	delete t;
+	return out;
+}
@@ -0,0 +1,75 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Metrics.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 04:11:21 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:16:31 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef METRICS_HPP
+# define METRICS_HPP
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <stdint.h>
+
+// Latenz-Histogramm im HDR-Stil: log-lineare Buckets in µs, pro
+// Zweierpotenz 4 Unterteilungen (max. 25 % Fehler), bis ~67 s, darüber +Inf.
+struct LatencyHist
+{
+	enum { SUB_BITS = 2, LINEAR = 2 << SUB_BITS, MAX_EXP = 26,
+		   BUCKETS = LINEAR + (MAX_EXP - SUB_BITS) * (1 << SUB_BITS) + 1 };
+
+	std::atomic<uint64_t> bucket[BUCKETS];
+	std::atomic<uint64_t> sum_us;
+
+	void record(uint64_t us);
+	static size_t   index(uint64_t us);
+	static uint64_t upper(size_t i);   // größter Wert im Bucket (inklusive)
+};
+
+// Zähler eines Workers. Jeder Worker schreibt nur seinen eigenen Slot
+// (ein Schreiber: load+store statt lock-Präfix), der Scrape liest alle und
+// summiert. Die Slots liegen in Shared Memory, damit auch bei
+// worker_processes jeder Prozess die Summe aller Worker ausliefert.
+struct WorkerMetrics
+{
+	enum Method { M_OTHER, M_GET, M_HEAD, M_POST, M_PUT, M_DELETE, M_OPTIONS, M_PATCH, M_COUNT };
+	enum Phase  { P_HEADER, P_HANDLER, P_WRITE, P_COUNT };
+	enum { STATUS_MIN = 100, STATUS_MAX = 599, TIMEOUT_PHASES = 6 };
+
+	std::atomic<uint64_t> accepted;
+	std::atomic<uint64_t> closed;
+	std::atomic<uint64_t> bytes_in;
+	std::atomic<uint64_t> bytes_out;
+	std::atomic<uint64_t> cgi_spawns;
+	std::atomic<uint64_t> fastcgi_requests;
+	std::atomic<uint64_t> cache_hits;
+	std::atomic<uint64_t> cache_misses;
+	std::atomic<uint64_t> timeouts[TIMEOUT_PHASES];   // Index = Server-Phase (Server.hpp)
+	std::atomic<uint64_t> requests[M_COUNT][STATUS_MAX - STATUS_MIN + 1];
+	LatencyHist           latency[P_COUNT];
+
+	static void add(std::atomic<uint64_t>& c, uint64_t n = 1)
+	{ c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+	void request(std::string_view method, int status);
+};
+
+class Metrics
+{
+	public:
+		// vor fork()/Threads: einen Slot pro Worker anlegen (Shared Memory)
+		static bool init(int workers);
+		// Slot des Workers; ohne init() ein privater Slot (nie NULL)
+		static WorkerMetrics& slot(int worker);
+		// Summe aller Slots im Prometheus-Textformat (version 0.0.4)
+		static std::string render();
+};
+
+#endif
@@ -0,0 +1,97 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutQueue.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:43:48 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "OutQueue.hpp"
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <algorithm>
+
+// mehr iovecs pro writev() bringen bei Socket-Puffern um 64K nichts
+static const int MAX_IOV = 64;
+
+void OutQueue::append(std::string&& s)
+{
+	if (s.empty()) return;
+	_total += s.size();
+	_buffered += s.size();
+	_segs.push_back(Segment());
+	_segs.back().buf.swap(s);
+}
+
+void OutQueue::append(const std::shared_ptr<const std::string>& blob)
+{
+	if (!blob || blob->empty()) return;
+	_total += blob->size();
+	_buffered += blob->size();
+	_segs.push_back(Segment());
+	_segs.back().blob = blob;
+}
+
+void OutQueue::appendFile(const std::shared_ptr<FileBody>& file, off_t off, size_t len)
+{
+	if (!file || len == 0) return;
+	_total += len;
+	_segs.push_back(Segment());
+	_segs.back().file = file;
+	_segs.back().off  = off;
+	_segs.back().len  = len;
+}
+
+ssize_t OutQueue::send(int fd)
+{
+	if (_segs.empty()) return 0;
+	if (_segs.front().file)
+		return sendFile(fd);
+
+	// alle Puffer bis zum nächsten Dateibereich in einem Rutsch
+	struct iovec iov[MAX_IOV];
+	int n = 0;
+	for (std::deque<Segment>::iterator it = _segs.begin(); it != _segs.end() && n < MAX_IOV && !it->file; ++it)
+	{
+		const std::string& d = it->data();
+		iov[n].iov_base = const_cast<char*>(d.data()) + it->off;
+		iov[n].iov_len  = d.size() - it->off;
+		++n;
+	}
+	ssize_t m = ::writev(fd, iov, n);
+	if (m > 0) consume(m);
+	return m;
+}
+
+// Datei geht nicht durch den User-Space
+ssize_t OutQueue::sendFile(int fd)
+{
+	Segment& s = _segs.front();
+	size_t chunk = std::min(s.len, (size_t)1 << 30);
+	ssize_t m = ::sendfile(fd, s.file->fd, &s.off, chunk);
+	if (m > 0)
+	{
+		s.len -= m;
+		if (s.len == 0) _segs.pop_front();
+	}
+	return m;
+}
+
+// n gesendete Bytes vorne abhaken: fertige Segmente raus, beim ersten
+// unfertigen nur den Offset weiterschieben
+void OutQueue::consume(size_t n)
+{
+	_buffered -= n;   // writev() sendet nur Puffer, nie Dateibereiche
+	while (n > 0)
+	{
+		Segment& s = _segs.front();
+		size_t left = s.data().size() - s.off;
+		if (n < left) { s.off += n; return; }
+		n -= left;
+		_segs.pop_front();
+	}
+}
@@ -0,0 +1,67 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutQueue.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:43:48 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef OUTQUEUE_HPP
+# define OUTQUEUE_HPP
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <cstddef>
+#include <sys/types.h>
+#include "FileCache.hpp"
+
+// Sendewarteschlange einer Verbindung: Header, Bodies, Dateibereiche und
+// geteilte Puffer (Response-Cache) liegen als Segmente hintereinander und
+// gehen per writev()/sendfile() raus. Gesendetes wird nur über Offsets
+// vermerkt – kein erase() vorne im String, auch nicht bei langsamen Clients.
+class OutQueue
+{
+	public:
+		OutQueue() : _total(0), _buffered(0) {}
+
+		void append(std::string&& s);                              // eigener Puffer
+		void append(const std::shared_ptr<const std::string>& blob); // geteilt, wird nicht kopiert
+		void appendFile(const std::shared_ptr<FileBody>& file, off_t off, size_t len);
+
+		bool   empty() const { return _segs.empty(); }
+		// Bytes, die noch im Speicher warten (ohne Dateibereiche)
+		size_t buffered() const { return _buffered; }
+		void   clear() { _segs.clear(); _buffered = 0; }
+		// alle je angehängten Bytes inkl. Dateibereiche (fürs Access-Log)
+		size_t total() const { return _total; }
+
+		// ein writev()/sendfile(); Rückgabe wie write(): gesendete Bytes,
+		// -1 mit errno, 0 = Datei ist beim Senden geschrumpft
+		ssize_t send(int fd);
+
+	private:
+		struct Segment
+		{
+			std::string                       buf;    // eigener Puffer
+			std::shared_ptr<const std::string> blob;  // geteilter Puffer
+			std::shared_ptr<FileBody>         file;   // Dateibereich per sendfile()
+			off_t  off = 0;   // Puffer: schon gesendet; Datei: nächster Offset
+			size_t len = 0;   // nur Datei: noch zu senden
+
+			const std::string& data() const { return blob ? *blob : buf; }
+		};
+
+		ssize_t sendFile(int fd);
+		void    consume(size_t n);
+
+		std::deque<Segment> _segs;
+		size_t              _total;
+		size_t              _buffered;   // mitgezählt in append()/consume()
+};
+
+#endif
@@ -0,0 +1,150 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Reactor.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:08:39 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Reactor.hpp"
+#include "Logger.hpp"
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+Reactor* Reactor::create(const std::string& backend, bool edge_triggered)
+{
+	if (backend != "poll")
+	{
+		EpollReactor* ep = new EpollReactor(edge_triggered);
+		if (ep->ok())
+			return ep;
+		logMsg(LogLevel::ERROR, "epoll_create1: %s", strerror(errno));
+		delete ep;
+	}
+	return new PollReactor();
+}
+
+// ---------------------------------------------------------------- poll
+
+static short toPoll(int events)
+{
+	short ev = 0;
+	if (events & EV_READ)  ev |= POLLIN;
+	if (events & EV_WRITE) ev |= POLLOUT;
+	return ev;
+}
+
+bool PollReactor::add(int fd, int events, uint64_t data)
+{
+	if (_index.count(fd)) { errno = EEXIST; return false; }
+	pollfd p{}; p.fd = fd; p.events = toPoll(events); p.revents = 0;
+	_index[fd] = _fds.size();
+	_fds.push_back(p);
+	_data.push_back(data);
+	return true;
+}
+
+bool PollReactor::modify(int fd, int events, uint64_t data)
+{
+	std::unordered_map<int, size_t>::iterator it = _index.find(fd);
+	if (it == _index.end()) { errno = ENOENT; return false; }
+	_fds[it->second].events = toPoll(events);
+	_data[it->second] = data;
+	return true;
+}
+
+void PollReactor::remove(int fd)
+{
+	std::unordered_map<int, size_t>::iterator it = _index.find(fd);
+	if (it == _index.end()) return;
+	size_t i = it->second, last = _fds.size() - 1;
+	if (i != last)
+	{
+		_fds[i]  = _fds[last];
+		_data[i] = _data[last];
+		_index[_fds[i].fd] = i;
+	}
+	_fds.pop_back();
+	_data.pop_back();
+	_index.erase(it);
+}
+
+int PollReactor::wait(std::vector<ReactorEvent>& out, int timeout_ms)
+{
+	out.clear();
+	int ready = ::poll(_fds.empty() ? NULL : &_fds[0], _fds.size(), timeout_ms);
+	if (ready <= 0) return ready;
+	for (size_t i = 0; i < _fds.size() && (int)out.size() < ready; ++i)
+	{
+		short re = _fds[i].revents;
+		if (re == 0) continue;
+		ReactorEvent e; e.data = _data[i]; e.events = 0;
+		if (re & POLLIN)  e.events |= EV_READ;
+		if (re & POLLOUT) e.events |= EV_WRITE;
+		if (re & (POLLHUP | POLLERR | POLLNVAL)) e.events |= EV_ERROR;
+		out.push_back(e);
+	}
+	return (int)out.size();
+}
+
+// ---------------------------------------------------------------- epoll
+
+EpollReactor::EpollReactor(bool edge_triggered)
+	: _epfd(::epoll_create1(EPOLL_CLOEXEC)), _et(edge_triggered), _buf(256) {}
+
+EpollReactor::~EpollReactor()
+{
+	if (_epfd >= 0) ::close(_epfd);
+}
+
+uint32_t EpollReactor::toEpoll(int events) const
+{
+	uint32_t ev = 0;
+	if (events & EV_READ)  ev |= EPOLLIN;
+	if (events & EV_WRITE) ev |= EPOLLOUT;
+	if (_et)               ev |= EPOLLET;
+	return ev;
+}
+
+bool EpollReactor::add(int fd, int events, uint64_t data)
+{
+	epoll_event e{}; e.events = toEpoll(events); e.data.u64 = data;
+	return ::epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &e) == 0;
+}
+
+bool EpollReactor::modify(int fd, int events, uint64_t data)
+{
+	epoll_event e{}; e.events = toEpoll(events); e.data.u64 = data;
+	return ::epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &e) == 0;
+}
+
+void EpollReactor::remove(int fd)
+{
+	epoll_event e{};   // Kernel < 2.6.9 will einen non-NULL Pointer
+	::epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, &e);
+}
+
+int EpollReactor::wait(std::vector<ReactorEvent>& out, int timeout_ms)
+{
+	out.clear();
+	int n = ::epoll_wait(_epfd, &_buf[0], (int)_buf.size(), timeout_ms);
+	if (n <= 0) return n;
+	out.reserve(n);
+	for (int i = 0; i < n; ++i)
+	{
+		ReactorEvent e; e.data = _buf[i].data.u64; e.events = 0;
+		if (_buf[i].events & EPOLLIN)  e.events |= EV_READ;
+		if (_buf[i].events & EPOLLOUT) e.events |= EV_WRITE;
+		if (_buf[i].events & (EPOLLHUP | EPOLLERR)) e.events |= EV_ERROR;
+		out.push_back(e);
+	}
+	if (n == (int)_buf.size())
+		_buf.resize(_buf.size() * 2);   // viele bereite fds -> nächstes Mal mehr auf einmal holen
+	return n;
+}
@@ -0,0 +1,98 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Reactor.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:08:39 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:08:39 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef REACTOR_HPP
+# define REACTOR_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/epoll.h>
+
+// Backend-unabhängige Event-Flags
+enum
+{
+	EV_READ  = 1 << 0,
+	EV_WRITE = 1 << 1,
+	EV_ERROR = 1 << 2   // HUP/ERR/NVAL, kommt nur in wait()-Ergebnissen vor
+};
+
+struct ReactorEvent
+{
+	uint64_t data;      // Token, das bei add()/modify() mitgegeben wurde
+	int      events;    // EV_*
+};
+
+// Kleine Abstraktion über poll/epoll: wait() liefert nur die fds, die
+// tatsächlich bereit sind, damit der Server nicht mehr alle Clients abklappert.
+class Reactor
+{
+	public:
+		virtual ~Reactor() {}
+
+		virtual bool add(int fd, int events, uint64_t data) = 0;
+		virtual bool modify(int fd, int events, uint64_t data) = 0;
+		virtual void remove(int fd) = 0;
+		// timeout_ms < 0 = unendlich; gibt Anzahl Events zurück, -1 bei Fehler (errno gesetzt)
+		virtual int  wait(std::vector<ReactorEvent>& out, int timeout_ms) = 0;
+		virtual const char* name() const = 0;
+		// true, wenn Handler bis EAGAIN lesen/schreiben müssen (edge-triggered)
+		virtual bool edgeTriggered() const { return false; }
+
+		// backend: "epoll" oder "poll"; fällt auf poll zurück, wenn epoll nicht geht
+		static Reactor* create(const std::string& backend, bool edge_triggered);
+};
+
+// Fallback: ein pollfd pro fd, Entfernen per swap-with-last
+class PollReactor : public Reactor
+{
+	public:
+		bool add(int fd, int events, uint64_t data);
+		bool modify(int fd, int events, uint64_t data);
+		void remove(int fd);
+		int  wait(std::vector<ReactorEvent>& out, int timeout_ms);
+		const char* name() const { return "poll"; }
+
+	private:
+		std::vector<pollfd>             _fds;
+		std::vector<uint64_t>           _data;
+		std::unordered_map<int, size_t> _index;   // fd -> Position in _fds
+};
+
+class EpollReactor : public Reactor
+{
+	public:
+		explicit EpollReactor(bool edge_triggered);
+		~EpollReactor();
+
+		bool ok() const { return _epfd >= 0; }
+		bool add(int fd, int events, uint64_t data);
+		bool modify(int fd, int events, uint64_t data);
+		void remove(int fd);
+		int  wait(std::vector<ReactorEvent>& out, int timeout_ms);
+		const char* name() const { return _et ? "epoll (edge-triggered)" : "epoll"; }
+		bool edgeTriggered() const { return _et; }
+
+	private:
+		EpollReactor(const EpollReactor&);
+		EpollReactor& operator=(const EpollReactor&);
+
+		uint32_t toEpoll(int events) const;
+
+		int                      _epfd;
+		bool                     _et;
+		std::vector<epoll_event> _buf;
+};
+
+#endif
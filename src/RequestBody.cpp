@@ -0,0 +1,168 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RequestBody.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:18:50 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "RequestBody.hpp"
+#include "Logger.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+RequestBody::RequestBody()
+	: _fd(-1), _size(0), _threshold((size_t)-1), _temp_dir("/tmp"), _map(NULL), _map_len(0) {}
+
+RequestBody::~RequestBody() { clear(); }
+
+RequestBody::RequestBody(RequestBody&& o)
+	: _fd(-1), _size(0), _threshold((size_t)-1), _map(NULL), _map_len(0)
+{
+	*this = std::move(o);
+}
+
+RequestBody& RequestBody::operator=(RequestBody&& o)
+{
+	if (this == &o) return *this;
+	clear();
+	_mem.swap(o._mem);
+	_fd = o._fd;               o._fd = -1;
+	_size = o._size;           o._size = 0;
+	_threshold = o._threshold;
+	_temp_dir.swap(o._temp_dir);
+	_map = o._map;             o._map = NULL;
+	_map_len = o._map_len;     o._map_len = 0;
+	return *this;
+}
+
+void RequestBody::setSpill(size_t threshold, const std::string& temp_dir)
+{
+	_threshold = threshold;
+	_temp_dir = temp_dir.empty() ? "/tmp" : temp_dir;
+}
+
+void RequestBody::unmap() const
+{
+	if (_map) ::munmap(_map, _map_len);
+	_map = NULL;
+	_map_len = 0;
+}
+
+void RequestBody::clear()
+{
+	unmap();
+	if (_fd >= 0) ::close(_fd);
+	_fd = -1;
+	_size = 0;
+	std::string().swap(_mem);
+}
+
+// Speicherinhalt in eine namenlose Datei verschieben. O_TMPFILE wenn
+// möglich, sonst mkstemp + sofort unlink; weg ist sie beim close().
+bool RequestBody::spill()
+{
+	int fd = ::open(_temp_dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		std::string tmpl = _temp_dir + "/webserv_body_XXXXXX";
+		fd = ::mkostemp(&tmpl[0], O_CLOEXEC);
+		if (fd < 0) { logMsg(LogLevel::ERROR, "mkstemp: %s", strerror(errno)); return false; }
+		::unlink(tmpl.c_str());
+	}
+	size_t off = 0;
+	while (off < _mem.size())
+	{
+		ssize_t w = ::pwrite(fd, _mem.data() + off, _mem.size() - off, off);
+		if (w < 0 && errno == EINTR) continue;
+		if (w <= 0) { logMsg(LogLevel::ERROR, "pwrite: %s", strerror(errno)); ::close(fd); return false; }
+		off += (size_t)w;
+	}
+	std::string().swap(_mem);
+	_fd = fd;
+	return true;
+}
+
+bool RequestBody::append(const char* data, size_t n)
+{
+	if (n == 0) return true;
+	unmap();
+	if (_fd < 0 && _size + n > _threshold && !spill())
+		return false;
+	if (_fd < 0)
+	{
+		_mem.append(data, n);
+		_size += n;
+		return true;
+	}
+	size_t off = 0;
+	while (off < n)
+	{
+		ssize_t w = ::pwrite(_fd, data + off, n - off, _size + off);
+		if (w < 0 && errno == EINTR) continue;
+		if (w <= 0) { logMsg(LogLevel::ERROR, "pwrite: %s", strerror(errno)); return false; }
+		off += (size_t)w;
+	}
+	_size += n;
+	return true;
+}
+
+std::string_view RequestBody::view() const
+{
+	if (_fd < 0) return std::string_view(_mem);
+	if (_size == 0) return std::string_view();
+	if (!_map)
+	{
+		void* p = ::mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		if (p == MAP_FAILED) { logMsg(LogLevel::ERROR, "mmap: %s", strerror(errno)); return std::string_view(); }
+		_map = p;
+		_map_len = _size;
+	}
+	return std::string_view(static_cast<const char*>(_map), _size);
+}
+
+bool RequestBody::writeTo(int out_fd) const
+{
+	if (_fd < 0)
+	{
+		size_t off = 0;
+		while (off < _mem.size())
+		{
+			ssize_t w = ::write(out_fd, _mem.data() + off, _mem.size() - off);
+			if (w < 0 && errno == EINTR) continue;
+			if (w <= 0) return false;
+			off += (size_t)w;
+		}
+		return true;
+	}
+	loff_t in_off = 0;
+	while ((size_t)in_off < _size)
+	{
+		ssize_t w = ::copy_file_range(_fd, &in_off, out_fd, NULL, _size - in_off, 0);
+		if (w < 0 && errno == EINTR) continue;
+		if (w <= 0)
+		{
+			// z. B. EXDEV auf alten Kernels: über den Speicher kopieren
+			std::string_view v = view();
+			if (v.size() != _size) return false;
+			while ((size_t)in_off < _size)
+			{
+				ssize_t n = ::write(out_fd, v.data() + in_off, _size - in_off);
+				if (n < 0 && errno == EINTR) continue;
+				if (n <= 0) return false;
+				in_off += n;
+			}
+			return true;
+		}
+	}
+	return true;
+}
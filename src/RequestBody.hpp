@@ -0,0 +1,61 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RequestBody.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:18:50 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:18:50 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef REQUESTBODY_HPP
+# define REQUESTBODY_HPP
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// Request-Body, der beim Empfang Stück für Stück wächst. Bis zur Schwelle
+// (client_body_buffer_size) liegt er im Speicher, darüber wandert alles in
+// eine anonyme Temp-Datei (client_body_temp_path) – ein 2 GB Upload kostet
+// so keine 2 GB RSS pro Verbindung.
+class RequestBody
+{
+	public:
+		RequestBody();
+		~RequestBody();
+		RequestBody(RequestBody&& o);
+		RequestBody& operator=(RequestBody&& o);
+
+		void   setSpill(size_t threshold, const std::string& temp_dir);
+		bool   append(const char* data, size_t n);   // false bei I/O-Fehler
+		void   clear();
+
+		size_t size() const  { return _size; }
+		bool   empty() const { return _size == 0; }
+		bool   inFile() const { return _fd >= 0; }
+		int    fd() const { return _fd; }
+		// ganzer Body am Stück; bei Datei per mmap (read-only, lazy)
+		std::string_view view() const;
+		// kompletten Body in fd schreiben (Datei: copy_file_range im Kernel)
+		bool   writeTo(int out_fd) const;
+
+	private:
+		RequestBody(const RequestBody&);
+		RequestBody& operator=(const RequestBody&);
+
+		bool spill();
+		void unmap() const;
+
+		std::string   _mem;
+		int           _fd;
+		size_t        _size;
+		size_t        _threshold;
+		std::string   _temp_dir;
+		mutable void* _map;
+		mutable size_t _map_len;
+};
+
+#endif
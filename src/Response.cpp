@@ -6,36 +6,54 @@
 /*   By: leokubler <leokubler@student.42.fr>        +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:31 by mhummel           #+#    #+#             */
-/*   Updated: 2025/11/12 11:52:46 by leokubler        ###   ########.fr       */
+/*   Updated: 2026/10/18 04:10:40 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "Response.hpp"
-#include "CGIHandler.hpp"
-#include <fstream>
+#include "LocationPolicy.hpp"
+#include <cerrno>
 #include <sstream>
 #include <sys/stat.h>
 #include <iostream>
 #include <iomanip>
 #include <dirent.h>
+#include <atomic>
 #include <algorithm>
 #include <cctype>
-
-ResponseHandler::ResponseHandler() {}
+#include <fcntl.h>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <string_view>
+#include <unistd.h>
+
+ResponseHandler::ResponseHandler(FileCache* files, GzipCache* gzip) : _files(files), _gzip(gzip) {}
 ResponseHandler::~ResponseHandler() {}
 
 // Response-Object to HTTP-string
-std::string Response::toString() const
+std::string Response::head() const
 {
-    std::ostringstream ss;
-    ss << "HTTP/1.1 " << statusCode << " " << reasonPhrase << "\r\n";
+    std::string code = std::to_string(statusCode);
+    size_t n = 16 + code.size() + reasonPhrase.size();
+    for (size_t i = 0; i < set_cookies.size(); ++i)
+        n += 14 + set_cookies[i].size();
+    n += headers.bytes() + headers.size() * 4;
+
+    std::string h;
+    h.reserve(n);
+    h += "HTTP/1.1 "; h += code; h += ' '; h += reasonPhrase; h += "\r\n";
 	for (size_t i = 0; i < set_cookies.size(); ++i)																// set cookies
-        ss << "Set-Cookie: " << set_cookies[i] << "\r\n";
-    for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it)	// headers
-        ss << it->first << ": " << it->second << "\r\n";
-    ss << "\r\n";
-    ss << body;
-    return ss.str();
+        { h += "Set-Cookie: "; h += set_cookies[i]; h += "\r\n"; }
+    for (size_t i = 0; i < headers.size(); ++i)																	// headers
+        { h += headers.name(i); h += ": "; h += headers.value(i); h += "\r\n"; }
+    h += "\r\n";
+    return h;
+}
+
+std::string Response::toString() const
+{
+    return blob ? head() + body + *blob : head() + body;
 }
 
 // Setzt ein Cookie im Response
@@ -50,18 +68,8 @@ void Response::setCookie(const std::string& name, const std::string& value, cons
 	if (!sameSite.empty()) sc << "; SameSite=" << sameSite; // "Lax"|"Strict"|"None"
 	set_cookies.push_back(sc.str());
 }
-static bool isCGIRequest(const std::string& path)
-{
-    size_t dot = path.find_last_of('.');
-    if (dot == std::string::npos)
-        return false;
-
-    std::string ext = path.substr(dot + 1);
-    return (ext == "py" || ext == "php" || ext == "cgi");
-}
-
 // URL-decode (simple)
-static std::string urlDecode(const std::string& s) {
+static std::string urlDecode(std::string_view s) {
     std::string ret;
     ret.reserve(s.size());
     for (size_t i = 0; i < s.size(); ++i) {
@@ -111,25 +119,6 @@ static std::string joinPath(const std::string& a, const std::string& b) {
     return out;
 }
 
-// MIME-Mapping (erweiterbar)
-static std::string getMimeType(const std::string& path) {
-    static const std::map<std::string, std::string> m = {
-        { "html", "text/html" }, { "htm", "text/html" }, { "css", "text/css" },
-        { "js", "application/javascript" }, { "json", "application/json" },
-        { "png", "image/png" }, { "jpg", "image/jpeg" }, { "jpeg", "image/jpeg" },
-        { "gif", "image/gif" }, { "svg", "image/svg+xml" }, { "txt", "text/plain" },
-        { "pdf", "application/pdf" }, { "ico", "image/x-icon" }
-    };
-    size_t dot = path.find_last_of('.');
-    if (dot == std::string::npos) return "application/octet-stream";
-    std::string ext = path.substr(dot + 1);
-    // lower
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    auto it = m.find(ext);
-    if (it != m.end()) return it->second;
-    return "application/octet-stream";
-}
-
 // Generiere einfaches Verzeichnis-Listing (HTML)
 static std::string generateDirectoryListing(const std::string& dirPath, const std::string& urlPrefix) {
     DIR* dp = opendir(dirPath.c_str());
@@ -151,33 +140,296 @@ static std::string generateDirectoryListing(const std::string& dirPath, const st
     return out.str();
 }
 
-// check file or dir via stat
-static bool isDirectory(const std::string& path) {
-    struct stat st;
-    if (stat(path.c_str(), &st) != 0) return false;
-    return S_ISDIR(st.st_mode);
-}
-
 std::string ResponseHandler::getStatusMessage(int code)
 {
 	switch (code)
 	{
 		case 200: return "OK";
+		case 206: return "Partial Content";
+		case 304: return "Not Modified";
 		case 404: return "Not Found";
 		case 405: return "Method not Allowed";
+		case 416: return "Range Not Satisfiable";
 		default : return "Unkown";
 	}
 }
 
-std::string ResponseHandler::readFile(const std::string& path)
+// stat()/open() nur beim ersten Mal, danach aus dem FileCache des Workers
+std::shared_ptr<FileEntry> ResponseHandler::lookup(const std::string& path)
+{
+	return _files ? _files->lookup(path) : FileCache::load(path);
+}
+
+// If-None-Match: Liste von ETags oder "*", Vergleich schwach (W/ egal)
+static bool etagMatches(const std::string& list, const std::string& etag)
+{
+	std::string_view tag(etag);
+	size_t i = 0;
+	while (i < list.size())
+	{
+		while (i < list.size() && (list[i] == ' ' || list[i] == '\t' || list[i] == ',')) ++i;
+		size_t start = i;
+		while (i < list.size() && list[i] != ',') ++i;
+		std::string_view t(list.data() + start, i - start);
+		while (!t.empty() && (t.back() == ' ' || t.back() == '\t')) t.remove_suffix(1);
+		if (t == "*") return true;
+		if (t.size() > 2 && t[0] == 'W' && t[1] == '/') t.remove_prefix(2);
+		if (!t.empty() && t == tag) return true;
+	}
+	return false;
+}
+
+// IMF-fixdate -> time_t, -1 wenn unlesbar
+static time_t parseHttpDate(const std::string& s)
+{
+	struct tm tm;
+	std::memset(&tm, 0, sizeof(tm));
+	const char* end = strptime(s.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	if (!end) return -1;
+	return timegm(&tm);
+}
+
+// RFC 9110 13.2.2: If-None-Match hat Vorrang, If-Modified-Since nur ohne
+bool ResponseHandler::notModified(const Request& req, const std::string& etag, time_t mtime)
+{
+	if (req.headers.has(H_IF_NONE_MATCH))
+		return etagMatches(std::string(req.headers.get(H_IF_NONE_MATCH)), etag);
+	if (req.headers.has(H_IF_MODIFIED_SINCE))
+	{
+		time_t t = parseHttpDate(std::string(req.headers.get(H_IF_MODIFIED_SINCE)));
+		return t != -1 && mtime <= t;
+	}
+	return false;
+}
+
+// vorkomprimierte Datei daneben (foo.css.gz), nur wenn nicht älter als das Original
+std::shared_ptr<FileEntry> ResponseHandler::sidecar(const FileEntry& fe, const char* ext)
+{
+	std::shared_ptr<FileEntry> s = lookup(fe.path + ext);
+	if (s->isFile() && s->st.st_mtime >= fe.st.st_mtime)
+		return s;
+	return std::shared_ptr<FileEntry>();
+}
+
+// Accept-Encoding: br-Sidecar, dann gz-Sidecar, dann einmal selbst
+// komprimiert (GzipCache). NULL = unkomprimiert ausliefern.
+const char* ResponseHandler::negotiate(const Request& req, const std::shared_ptr<FileEntry>& fe,
+									   std::shared_ptr<FileEntry>& side, std::shared_ptr<const std::string>& zbody)
+{
+	AcceptEncoding ae = parseAcceptEncoding(req.headers.get(H_ACCEPT_ENCODING));
+	if (ae.br && (side = sidecar(*fe, ".br")))
+		return "br";
+	if (ae.gzip && (side = sidecar(*fe, ".gz")))
+		return "gzip";
+	if (ae.gzip && (zbody = _gzip->get(fe)))
+		return "gzip";
+	return NULL;
+}
+
+// Der Inhalt geht später per sendfile() raus; fd und Metadaten kommen aus dem Cache
+void ResponseHandler::serveFile(const Request& req, const std::shared_ptr<FileEntry>& fe, Response& res)
 {
-	std::ifstream file(path.c_str());
-	if (!file.is_open())
-		return "<h1>Error opening file</h1>";;
+	// Kodierung aushandeln; Range-Requests bekommen immer die Originaldatei
+	std::shared_ptr<FileEntry> side;
+	std::shared_ptr<const std::string> zbody;
+	const char* enc = NULL;
+	if (_gzip && isCompressible(fe->mime))
+	{
+		res.headers.set(H_VARY, "Accept-Encoding");
+		if (!req.headers.has(H_RANGE))
+			enc = negotiate(req, fe, side, zbody);
+	}
+	// jede Repräsentation hat ihr eigenes ETag (Sidecar und selbst komprimiert unterscheiden sich)
+	std::string etag = !enc ? fe->etag : variantEtag(fe->etag, side ? (enc[0] == 'b' ? "br" : "gz") : "gzip");
 
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	return buffer.str();
+	res.headers.set(H_ETAG, etag);
+	res.headers.set(H_LAST_MODIFIED, fe->last_modified);
+	if (notModified(req, etag, fe->st.st_mtime))
+	{
+		// 304 ohne Body: weder Datei noch Content-Length/-Type
+		res.statusCode = 304;
+		res.reasonPhrase = getStatusMessage(304);
+		res.body.clear();
+		res.headers.erase(H_CONTENT_TYPE);
+		return;
+	}
+	res.statusCode = 200;
+	res.reasonPhrase = getStatusMessage(200);
+	res.source = fe;
+	if (enc)
+	{
+		res.headers.set(H_CONTENT_ENCODING, enc);
+		res.headers.set(H_CONTENT_TYPE, fe->mime);
+		res.variant = side;
+		if (side)
+		{
+			res.file = side->file;
+			res.file_off = 0;
+			res.file_len = (size_t)side->st.st_size;
+			res.body.clear();
+		}
+		else
+		{
+			res.body.clear();
+			res.blob = zbody;
+		}
+		res.headers.set(H_CONTENT_LENGTH, std::to_string(side ? res.file_len : res.blob->size()));
+		return;
+	}
+	res.file = fe->file;
+	res.file_off = 0;
+	res.file_len = (size_t)fe->st.st_size;
+	res.body.clear();
+	res.headers.set(H_ACCEPT_RANGES, "bytes");
+	res.headers.set(H_CONTENT_LENGTH, std::to_string(res.file_len));
+	res.headers.set(H_CONTENT_TYPE, fe->mime);
+	serveRanges(req, *fe, res);
+}
+
+struct ByteRange { off_t first, last; };   // inklusiv
+
+// "bytes=0-99, 200-, -50" -> sortierte, zusammengelegte Bereiche innerhalb size.
+// -1 = Syntaxfehler (Range ignorieren), 0 = nichts erfüllbar (416), sonst Anzahl.
+static int parseRanges(const std::string& spec, off_t size, std::vector<ByteRange>& out)
+{
+	static const size_t MAX_RANGES = 16;   // mehr nur bei Angriffen, dann ganze Datei
+	if (spec.compare(0, 6, "bytes=") != 0) return -1;
+	size_t i = 6;
+	size_t n = 0;
+	while (i < spec.size())
+	{
+		while (i < spec.size() && (spec[i] == ' ' || spec[i] == '\t' || spec[i] == ',')) ++i;
+		if (i >= spec.size()) break;
+		if (++n > MAX_RANGES) return -1;
+		bool suffix = (spec[i] == '-');
+		if (suffix) ++i;
+		if (i >= spec.size() || !isdigit((unsigned char)spec[i])) return -1;
+		char* end;
+		unsigned long long a = std::strtoull(spec.c_str() + i, &end, 10);
+		i = end - spec.c_str();
+		unsigned long long b = ~0ULL;
+		if (!suffix)
+		{
+			if (i >= spec.size() || spec[i] != '-') return -1;
+			++i;
+			if (i < spec.size() && isdigit((unsigned char)spec[i]))
+			{
+				b = std::strtoull(spec.c_str() + i, &end, 10);
+				i = end - spec.c_str();
+				if (b < a) return -1;
+			}
+		}
+		while (i < spec.size() && (spec[i] == ' ' || spec[i] == '\t')) ++i;
+		if (i < spec.size() && spec[i] != ',') return -1;
+
+		ByteRange r;
+		if (suffix)
+		{
+			if (a == 0 || size == 0) continue;                 // "-0" ist nicht erfüllbar
+			r.first = (a >= (unsigned long long)size) ? 0 : size - (off_t)a;
+			r.last  = size - 1;
+		}
+		else
+		{
+			if (a >= (unsigned long long)size) continue;       // hinter dem Dateiende
+			r.first = (off_t)a;
+			r.last  = (b >= (unsigned long long)size) ? size - 1 : (off_t)b;
+		}
+		out.push_back(r);
+	}
+	if (n == 0) return -1;
+	std::sort(out.begin(), out.end(), [](const ByteRange& x, const ByteRange& y) { return x.first < y.first; });
+	size_t w = 0;
+	for (size_t k = 0; k < out.size(); ++k)
+	{
+		if (w > 0 && out[k].first <= out[w - 1].last + 1)
+			out[w - 1].last = std::max(out[w - 1].last, out[k].last);
+		else
+			out[w++] = out[k];
+	}
+	out.resize(w);
+	return (int)w;
+}
+
+// If-Range: nur bei passendem (starkem) ETag bzw. exakt gleichem Datum gilt Range
+static bool ifRangeMatches(const std::string& v, const FileEntry& fe)
+{
+	if (!v.empty() && (v[0] == '"' || v.compare(0, 2, "W/") == 0))
+		return v == fe.etag;
+	return v == fe.last_modified;
+}
+
+// Range auf eine 200er Datei-Antwort anwenden: 206 mit einem Bereich direkt
+// aus der Datei, mehrere als multipart/byteranges (Trenner als FileParts),
+// 416 wenn nichts erfüllbar ist. Ohne (gültigen) Range bleibt alles bei 200.
+bool ResponseHandler::serveRanges(const Request& req, const FileEntry& fe, Response& res)
+{
+	if (!req.headers.has(H_RANGE) || req.method != "GET")
+		return false;
+	std::string range(req.headers.get(H_RANGE));
+	if (req.headers.has(H_IF_RANGE) && !ifRangeMatches(std::string(req.headers.get(H_IF_RANGE)), fe))
+		return false;
+
+	off_t size = fe.st.st_size;
+	std::vector<ByteRange> rs;
+	int n = parseRanges(range, size, rs);
+	if (n < 0)
+		return false;
+	std::string total = std::to_string((long long)size);
+	if (n == 0)
+	{
+		res.statusCode = 416;
+		res.reasonPhrase = getStatusMessage(416);
+		res.file.reset();
+		res.file_len = 0;
+		res.body = "<h1>416 Range Not Satisfiable</h1>";
+		res.headers.set(H_CONTENT_TYPE, "text/html");
+		res.headers.set(H_CONTENT_RANGE, "bytes */" + total);
+		res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+		return true;
+	}
+
+	res.statusCode = 206;
+	res.reasonPhrase = getStatusMessage(206);
+	if (n == 1)
+	{
+		res.file_off = rs[0].first;
+		res.file_len = (size_t)(rs[0].last - rs[0].first + 1);
+		res.headers.set(H_CONTENT_RANGE, "bytes " + std::to_string((long long)rs[0].first) + "-"
+			+ std::to_string((long long)rs[0].last) + "/" + total);
+		res.headers.set(H_CONTENT_LENGTH, std::to_string(res.file_len));
+		return true;
+	}
+
+	// bei worker_threads teilen sich alle Worker den Zähler
+	static std::atomic<unsigned long> counter(0);
+	char boundary[40];
+	snprintf(boundary, sizeof(boundary), "webserv%08lx%08lx", (unsigned long)getpid(),
+		counter.fetch_add(1, std::memory_order_relaxed) + 1);
+	size_t length = 0;
+	for (size_t k = 0; k < rs.size(); ++k)
+	{
+		FilePart p;
+		p.prefix = (k ? "\r\n--" : "--") + std::string(boundary) + "\r\nContent-Type: " + fe.mime
+			+ "\r\nContent-Range: bytes " + std::to_string((long long)rs[k].first) + "-"
+			+ std::to_string((long long)rs[k].last) + "/" + total + "\r\n\r\n";
+		p.off = rs[k].first;
+		p.len = (size_t)(rs[k].last - rs[k].first + 1);
+		length += p.prefix.size() + p.len;
+		res.parts.push_back(p);
+	}
+	FilePart end;
+	end.prefix = "\r\n--" + std::string(boundary) + "--\r\n";
+	end.off = 0;
+	end.len = 0;
+	length += end.prefix.size();
+	res.parts.push_back(end);
+
+	res.file_off = 0;
+	res.file_len = 0;   // alles steckt in parts
+	res.headers.set(H_CONTENT_TYPE, "multipart/byteranges; boundary=" + std::string(boundary));
+	res.headers.set(H_CONTENT_LENGTH, std::to_string(length));
+	return true;
 }
 
 bool ResponseHandler::fileExists(const std::string& path)
@@ -188,24 +440,32 @@ bool ResponseHandler::fileExists(const std::string& path)
 
 Response ResponseHandler::handleRequest(const Request& req, const LocationConfig& config)
 {
-	Response res;
-	printf("config_path: %s\n", config.path.c_str());
+	Response res(req.headers.resource());
 
 	res.keep_alive = req.keep_alive;
 	
 	// default headers
-	res.headers["Server"] = "webserv/1.0";
-    // res.headers["Connection"] = "close";
-	res.headers["Keep-Alive"] = req.keep_alive ? "timeout=5, max=100" : "timeout=0, max=0";
-    res.headers["Content-Type"] = "text/html";
-
-	std::string path = config.root + "/" + config.index; // default path 
-		
-	printf("path: %s\n", path.c_str());
-	if (isCGIRequest(req.path))
+	res.headers.set(H_SERVER, "webserv/1.0");
+    // res.headers.set(H_CONNECTION, "close");
+	res.headers.set(H_KEEP_ALIVE, req.keep_alive ? "timeout=5, max=100" : "timeout=0, max=0");
+    res.headers.set(H_CONTENT_TYPE, "text/html");
+
+	// Root, Index, CGI-Endungen: einmal beim Start kompiliert
+	const LocationPolicy& policy = *config.policy;
+
+	if (policy.cgiFor(req.path))
 	{
-		CGIHandler cgi;
-		return cgi.execute(req);
+		std::string url = normalizePath(urlDecode(req.path));
+		if (containsPathTraversal(url)) {
+			res.statusCode = 403;
+			res.reasonPhrase = "Forbidden";
+			res.body = "<h1>403 Forbidden</h1>";
+			res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+			return res;
+		}
+		// Ausführung übernimmt der Server im Event-Loop (blockiert sonst alle)
+		res.cgi_script = policy.map(url);
+		return res;
 	}
 	if (req.method == "GET")
 	{
@@ -218,37 +478,28 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 			res.statusCode = 403;
 			res.reasonPhrase = "Forbidden";
 			res.body = "<h1>403 Forbidden</h1>";
-			res.headers["Content-Type"] = "text/html";
-			res.headers["Content-Length"] = std::to_string(res.body.size());
+			res.headers.set(H_CONTENT_TYPE, "text/html");
+			res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
 			return res;
 		}
 
-		// 2) Find location root
-		//    Build filesystem path relative to location.root
-		std::string fsPath = config.root;
-		if (fsPath.empty()) fsPath = "."; // fallback
-		// strip location path prefix if present: assume req.path is the full URL path; 
-		// if location.path is not "/", remove prefix
-		std::string trimmedUrl = url;
-		if (!config.path.empty() && config.path != "/" && trimmedUrl.find(config.path) == 0) {
-			trimmedUrl = trimmedUrl.substr(config.path.length());
-			if (trimmedUrl.empty()) trimmedUrl = "/";
-		}
-		fsPath = joinPath(fsPath, trimmedUrl);
+		// 2) URL ohne Location-Präfix unter den Root der Location
+		std::string fsPath = policy.map(url);
 
 		// 3) If path is directory -> serve index or autoindex
-		if (isDirectory(fsPath)) {
+		std::shared_ptr<FileEntry> fe = lookup(fsPath);
+		if (fe->err == 0 && fe->is_dir) {
 			// ensure trailing slash in URL behavior handled elsewhere; here we just check
-			std::string indexFile = joinPath(fsPath, config.index.empty() ? "index.html" : config.index);
-			if (fileExists(indexFile))
+			std::string indexFile = (fsPath == policy.root) ? policy.root_index : joinPath(fsPath, policy.index);
+			std::shared_ptr<FileEntry> index = lookup(indexFile);
+			if (index->err == 0)
 			{
 				// serve index file
-				res.statusCode = 200;
-				res.reasonPhrase = getStatusMessage(200);
-				res.body = readFile(indexFile);
-				res.headers["Content-Type"] = getMimeType(indexFile);
-				res.headers["Content-Length"] = std::to_string(res.body.size());
-				return res;
+				if (index->isFile())
+				{
+					serveFile(req, index, res);
+					return res;
+				}
 			}
 			else if (config.autoindex)
 			{
@@ -258,8 +509,8 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 				res.statusCode = 200;
 				res.reasonPhrase = getStatusMessage(200);
 				res.body = listing;
-				res.headers["Content-Type"] = "text/html";
-				res.headers["Content-Length"] = std::to_string(res.body.size());
+				res.headers.set(H_CONTENT_TYPE, "text/html");
+				res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
 				return res;
 			}
 			else
@@ -267,47 +518,43 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 				res.statusCode = 403;
 				res.reasonPhrase = "Forbidden";
 				res.body = "<h1>403 Forbidden</h1><p>Index disabled.</p>";
-				res.headers["Content-Type"] = "text/html";
-				res.headers["Content-Length"] = std::to_string(res.body.size());
+				res.headers.set(H_CONTENT_TYPE, "text/html");
+				res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
 				return res;
 			}
 		}
 
 		// 4) If path is file -> CGI? or static
-		if (fileExists(fsPath)) {
-			// If CGI extension detected, forward to CGI handler (you may need to pass filesystem path in req)
-			if (isCGIRequest(fsPath))
+		if (fe->err == 0 && !fe->is_dir) {
+			// If CGI extension detected, forward to CGI handler
+			if (policy.cgiFor(fsPath))
 			{
-				CGIHandler cgi;
-				return cgi.execute(req); // consider setting env/path in req for CGI
+				res.cgi_script = fsPath;
+				return res;
 			}
 
 			// Serve file
-			res.statusCode = 200;
-			res.reasonPhrase = getStatusMessage(200);
-			res.body = readFile(fsPath);
-			res.headers["Content-Type"] = getMimeType(fsPath);
-			res.headers["Content-Length"] = std::to_string(res.body.size());
-			return res;
-		}
-		else
-		{
-			// Not found
-			res.statusCode = 404;
-			res.reasonPhrase = getStatusMessage(404);
-			res.body = "<h1>404 Not Found</h1>";
-			res.headers["Content-Type"] = "text/html";
-			res.headers["Content-Length"] = std::to_string(res.body.size());
-			return res;
+			if (fe->isFile())
+			{
+				serveFile(req, fe, res);
+				return res;
+			}
 		}
+
+		// Not found (or not readable)
+		res.statusCode = 404;
+		res.reasonPhrase = getStatusMessage(404);
+		res.body = "<h1>404 Not Found</h1>";
+		res.headers.set(H_CONTENT_TYPE, "text/html");
+		res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+		return res;
 	}
 
 	else if (req.method == "POST")
 	{
-		std::string dir = config.data_dir.empty() ? "./data" : config.data_dir;
+		const std::string& dir = policy.data_dir;
 		std::string contentType;
-		if (req.headers.count("Content-Type"))
-			contentType = req.headers.find("Content-Type")->second;
+		contentType.assign(req.headers.get(H_CONTENT_TYPE));
 
 		// --- Multipart upload ---
 		if (contentType.find("multipart/form-data") != std::string::npos)
@@ -323,7 +570,7 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 			else
 			{
 				std::string boundary = "--" + contentType.substr(pos + 9);
-				std::string body = req.body;
+				std::string_view body = req.body.view();   // bei großen Bodies gemappte Temp-Datei
 
 				// 2. Datei extrahieren (vereinfachte Variante)
 				size_t fileStart = body.find("filename=\"");
@@ -337,7 +584,7 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 				{
 					fileStart += 10;
 					size_t fileEnd = body.find("\"", fileStart);
-					std::string originalName = body.substr(fileStart, fileEnd - fileStart);
+					std::string originalName(body.substr(fileStart, fileEnd - fileStart));
 
 					// 3. Dateidatenbereich suchen
 					size_t dataStart = body.find("\r\n\r\n", fileEnd);
@@ -351,10 +598,10 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 					{
 						dataStart += 4;
 						size_t dataEnd = body.find(boundary, dataStart);
-						std::string fileContent = body.substr(dataStart, dataEnd - dataStart);
+						std::string_view fileContent = body.substr(dataStart, dataEnd - dataStart);
 						// Strip trailing \r\n if present
 						if (fileContent.size() >= 2 && fileContent[fileContent.size() - 2] == '\r')
-							fileContent.erase(fileContent.size() - 2);
+							fileContent.remove_suffix(2);
 
 						// 4. Sicherer Dateiname (keine Pfad-Traversal)
 						for (size_t i = 0; i < originalName.size(); ++i)
@@ -364,8 +611,19 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 						std::string filePath = dir + "/" + originalName;
 
 						// 5. Datei speichern
-						std::ofstream out(filePath.c_str(), std::ios::binary);
-						if (!out.is_open())
+						// O_CLOEXEC: bei worker_threads kann ein anderer Worker gerade ein CGI starten
+						int out = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+						size_t done = 0;
+						while (out >= 0 && done < fileContent.size())
+						{
+							ssize_t w = write(out, fileContent.data() + done, fileContent.size() - done);
+							if (w < 0 && errno == EINTR) continue;
+							if (w <= 0) break;
+							done += (size_t)w;
+						}
+						bool ok = (out >= 0 && done == fileContent.size());
+						if (out >= 0) close(out);
+						if (!ok)
 						{
 							res.statusCode = 500;
 							res.reasonPhrase = "Internal Server Error";
@@ -373,9 +631,6 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 						}
 						else
 						{
-							out.write(fileContent.data(), fileContent.size());
-							out.close();
-
 							res.statusCode = 200;
 							res.reasonPhrase = getStatusMessage(200);
 							res.body = "<h1>Upload successful!</h1><p>Saved as " + filePath + "</p>";
@@ -389,8 +644,10 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 		else
 		{
 			std::string filename = dir + "/upload_" + std::to_string(time(NULL));
-			std::ofstream out(filename.c_str(), std::ios::binary);
-			if (!out.is_open())
+			int out = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			bool ok = (out >= 0 && req.body.writeTo(out));   // Temp-Datei wird im Kernel kopiert
+			if (out >= 0) close(out);
+			if (!ok)
 			{
 				res.statusCode = 500;
 				res.reasonPhrase = "Internal Server Error";
@@ -398,8 +655,6 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 			}
 			else
 			{
-				out.write(req.body.data(), req.body.size());
-				out.close();
 
 				res.statusCode = 200;
 				res.reasonPhrase = getStatusMessage(200);
@@ -410,10 +665,9 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 
 	else if (req.method == "DELETE")
 	{
-		std::string dir = config.data_dir.empty() ? "./data" : config.data_dir;
+		const std::string& dir = policy.data_dir;
 		std::string filepath = dir;
-		filepath += "/" + req.body; // assuming the filename to delete is in the body
-		std::cout << "DELETE path: " << filepath << std::endl;
+		filepath += "/" + std::string(req.body.view()); // assuming the filename to delete is in the body
 
 		if (fileExists(filepath) && std::remove(filepath.c_str()) == 0)
 		{
@@ -434,7 +688,6 @@ Response ResponseHandler::handleRequest(const Request& req, const LocationConfig
 		res.reasonPhrase = getStatusMessage(405);
         res.body = "<h1>405 Method Not Allowed</h1>";
 	}
-	res.headers ["Content-Length"] = std::to_string(res.body.size());
-	std::cout << res.toString() << std::endl;
+	res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
 	return res;
 }
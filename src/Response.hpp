@@ -6,7 +6,7 @@
 /*   By: leokubler <leokubler@student.42.fr>        +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:34 by mhummel           #+#    #+#             */
-/*   Updated: 2025/11/11 10:01:35 by leokubler        ###   ########.fr       */
+/*   Updated: 2026/10/18 03:58:50 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -15,18 +15,46 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <memory>
+#include <sys/types.h>
 #include "HTTPHandler.hpp"
+#include "FileCache.hpp"
+#include "Compression.hpp"
 
+// Ein Teil eines multipart/byteranges-Bodys: Trenner/Part-Header, dann
+// [off, off+len) aus der Datei. Der Abschluss ist ein Teil mit len == 0.
+struct FilePart
+{
+	std::string prefix;
+	off_t  off;
+	size_t len;
+};
+
+// headers liegen in der Arena des Requests (siehe handleRequest), alles was
+// in die Sendewarteschlange oder den Cache wandert, bleibt std::string.
 struct Response
 {
+	explicit Response(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+		: headers(mr) {}
+
 	int statusCode;
 	std::string reasonPhrase;
-	std::map<std::string, std::string> headers;
+	HeaderMap headers;
 	std::string body;
+	std::shared_ptr<const std::string> blob;   // nach body: geteilter Puffer (GzipCache), wird nicht kopiert
 	bool keep_alive = false;
 	std::vector<std::string> set_cookies;
+	std::shared_ptr<FileBody> file;   // statt body: Bereich [file_off, file_off+file_len)
+	off_t  file_off = 0;
+	size_t file_len = 0;
+	std::vector<FilePart> parts;         // nach [file_off, file_len): weitere Bereiche (Multi-Range)
+	std::shared_ptr<FileEntry> source;   // Cache-Eintrag der ausgelieferten Datei (falls statisch)
+	std::shared_ptr<FileEntry> variant;  // .gz/.br-Sidecar, falls statt source ausgeliefert
+	std::string cgi_script;              // nicht leer: Server startet dieses CGI asynchron
 
-	std::string toString() const;
+	std::string head() const;         // Statuszeile + Header + Leerzeile
+	std::string toString() const;     // head() + body + blob (ohne file)
 	void setCookie(const std::string& name, const std::string& value, const std::string& path = "/", int maxAge = -1, bool httpOnly = false,
                    const std::string& sameSite = "");
 };
@@ -34,15 +62,24 @@ struct Response
 class ResponseHandler
 {
 	public:
-		ResponseHandler();
+		explicit ResponseHandler(FileCache* files = NULL, GzipCache* gzip = NULL);
 		~ResponseHandler();
 
 		Response handleRequest(const Request& req, const LocationConfig& config);
 
 	private:
 		std::string getStatusMessage(int code);
-		std::string readFile(const std::string& path);
+		std::shared_ptr<FileEntry> lookup(const std::string& path);
+		void serveFile(const Request& req, const std::shared_ptr<FileEntry>& fe, Response& res);
+		bool notModified(const Request& req, const std::string& etag, time_t mtime);
+		const char* negotiate(const Request& req, const std::shared_ptr<FileEntry>& fe,
+							  std::shared_ptr<FileEntry>& side, std::shared_ptr<const std::string>& zbody);
+		std::shared_ptr<FileEntry> sidecar(const FileEntry& fe, const char* ext);
+		bool serveRanges(const Request& req, const FileEntry& fe, Response& res);
 		bool fileExists(const std::string& path);
+
+		FileCache* _files;
+		GzipCache* _gzip;     // NULL = gzip off (auch keine Sidecars)
 };
 
 #endif
@@ -0,0 +1,108 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ResponseCache.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:24:45 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:44:43 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ResponseCache.hpp"
+#include "Response.hpp"
+#include <unistd.h>
+#include <cerrno>
+
+ResponseCache::ResponseCache(size_t max_bytes, size_t max_object)
+	: hits(0), misses(0), stores(0), evictions(0),
+	  _max_bytes(max_bytes), _max_object(max_object), _bytes(0) {}
+
+// grobe Speicherkosten eines Eintrags inkl. Key und Verwaltung
+size_t ResponseCache::cost(const std::string& key, const Entry& e)
+{
+	return key.size() * 2 + e.head->size() + e.body->size() + 128;
+}
+
+void ResponseCache::erase(std::unordered_map<std::string, Node>::iterator it)
+{
+	_bytes -= cost(it->first, it->second.e);
+	_lru.erase(it->second.lru);
+	_map.erase(it);
+}
+
+const ResponseCache::Entry* ResponseCache::lookup(const std::string& key)
+{
+	std::unordered_map<std::string, Node>::iterator it = _map.find(key);
+	if (it == _map.end()) { ++misses; return NULL; }
+	if (it->second.e.source->stale || (it->second.e.variant && it->second.e.variant->stale))
+	{
+		erase(it);
+		++misses;
+		return NULL;
+	}
+	_lru.splice(_lru.begin(), _lru, it->second.lru);
+	++hits;
+	return &it->second.e;
+}
+
+bool ResponseCache::store(const std::string& key, const Response& res)
+{
+	if (res.statusCode != 200 || !res.source || res.source->stale || !res.set_cookies.empty())
+		return false;
+	size_t size = res.file ? res.file_len : res.body.size() + (res.blob ? res.blob->size() : 0);
+	if ((res.file && res.file_off != 0) || size > _max_object)
+		return false;
+
+	Entry e;
+	e.source  = res.source;
+	e.variant = res.variant;
+	// nur geteilter Puffer (gzip aus dem GzipCache): denselben Block behalten statt Kopie
+	if (res.blob && res.body.empty() && !res.file)
+		e.body = res.blob;
+	else
+	{
+		std::shared_ptr<std::string> body = std::make_shared<std::string>();
+		if (!res.file)
+		{
+			*body = res.body;
+			if (res.blob) *body += *res.blob;
+		}
+		else
+			body->resize(res.file_len);
+		size_t got = 0;
+		while (res.file && got < res.file_len)
+		{
+			ssize_t n = pread(res.file->fd, &(*body)[got], res.file_len - got, res.file_off + got);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;     // Datei geschrumpft o.ä. -> nicht cachen
+			got += n;
+		}
+		e.body = body;
+	}
+	std::shared_ptr<std::string> head = std::make_shared<std::string>(res.head());
+	head->erase(head->size() - 2);   // nur Statuszeile + Header, ohne Leerzeile
+	e.head = head;
+
+	size_t c = cost(key, e);
+	if (c > _max_bytes) return false;
+
+	std::unordered_map<std::string, Node>::iterator old = _map.find(key);
+	if (old != _map.end()) erase(old);
+	while (_bytes + c > _max_bytes && !_lru.empty())
+	{
+		erase(_map.find(_lru.back()));
+		++evictions;
+	}
+	_lru.push_front(key);
+	Node& n = _map[key];
+	n.e.head.swap(e.head);
+	n.e.body.swap(e.body);
+	n.e.source = e.source;
+	n.e.variant = e.variant;
+	n.lru = _lru.begin();
+	_bytes += c;
+	++stores;
+	return true;
+}
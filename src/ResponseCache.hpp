@@ -0,0 +1,78 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ResponseCache.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:24:45 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:44:43 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef RESPONSECACHE_HPP
+# define RESPONSECACHE_HPP
+
+#include <string>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include "FileCache.hpp"
+
+struct Response;
+
+// Fertig serialisierte Antworten (Statuszeile + Header + Body) für kleine,
+// oft angefragte Dateien einer Location. Ein Treffer geht ohne Handler,
+// stat() oder read() direkt in den Sendepuffer.
+//
+// Gültigkeit hängt am FileCache-Eintrag der Datei: wird der per inotify
+// verworfen (stale), ist auch die gespeicherte Antwort tot.
+class ResponseCache
+{
+	public:
+		ResponseCache(size_t max_bytes, size_t max_object);
+
+		// Treffer: head endet vor der Leerzeile, damit ein "X-Cache"-Header
+		// noch dazwischen passt; body ist der komplette Dateiinhalt. Beide
+		// gehen geteilt in die OutQueue und überleben so auch eine Verdrängung.
+		struct Entry
+		{
+			std::shared_ptr<const std::string> head;
+			std::shared_ptr<const std::string> body;
+			std::shared_ptr<FileEntry> source;
+			std::shared_ptr<FileEntry> variant;   // .gz/.br-Sidecar oder NULL
+		};
+
+		const Entry* lookup(const std::string& key);
+		// speichert res, wenn es eine kleine statische 200er Antwort ist
+		// (Datei per sendfile oder bereits komprimiert in res.body)
+		bool store(const std::string& key, const Response& res);
+
+		size_t bytes() const { return _bytes; }
+		size_t size() const { return _map.size(); }
+
+		size_t hits;
+		size_t misses;
+		size_t stores;
+		size_t evictions;
+
+	private:
+		typedef std::list<std::string> Lru;
+		struct Node
+		{
+			Entry         e;
+			Lru::iterator lru;
+		};
+
+		static size_t cost(const std::string& key, const Entry& e);
+		void erase(std::unordered_map<std::string, Node>::iterator it);
+
+		size_t _max_bytes;
+		size_t _max_object;
+		size_t _bytes;
+		Lru    _lru;                                  // vorne = zuletzt benutzt
+		std::unordered_map<std::string, Node> _map;
+};
+
+#endif
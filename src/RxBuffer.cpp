@@ -0,0 +1,119 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RxBuffer.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:59:40 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:04:58 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "RxBuffer.hpp"
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+BufferPool& BufferPool::local()
+{
+	static thread_local BufferPool pool;
+	return pool;
+}
+
+BufferPool::~BufferPool()
+{
+	for (size_t i = 0; i < _free.size(); ++i)
+		delete[] _free[i];
+}
+
+char* BufferPool::get()
+{
+	if (_free.empty()) return new char[BLOCK];
+	char* b = _free.back();
+	_free.pop_back();
+	return b;
+}
+
+void BufferPool::put(char* b)
+{
+	if (_free.size() < KEEP) _free.push_back(b);
+	else delete[] b;
+}
+
+void RxBuffer::drop()
+{
+	if (!_data) return;
+	if (_heap) std::free(_data);
+	else       BufferPool::local().put(_data);
+	_data = NULL;
+	_len = _cap = 0;
+	_heap = false;
+}
+
+// erster Block aus dem Pool, darüber verdoppeln auf dem Heap
+void RxBuffer::reserve(size_t cap)
+{
+	if (cap <= _cap) return;
+	if (!_data && cap <= (size_t)BufferPool::BLOCK) {
+		_data = BufferPool::local().get();
+		_cap  = BufferPool::BLOCK;
+		return;
+	}
+	size_t n = _cap ? _cap : (size_t)BufferPool::BLOCK;
+	while (n < cap) n *= 2;
+	char* p;
+	if (_heap) p = static_cast<char*>(std::realloc(_data, n));
+	else {
+		p = static_cast<char*>(std::malloc(n));
+		if (p && _len) std::memcpy(p, _data, _len);
+	}
+	if (!p) throw std::bad_alloc();
+	if (!_heap && _data) BufferPool::local().put(_data);
+	_data = p;
+	_cap  = n;
+	_heap = true;
+}
+
+void RxBuffer::append(const char* p, size_t n)
+{
+	if (n == 0) return;
+	reserve(_len + n);
+	std::memcpy(_data + _len, p, n);
+	_len += n;
+}
+
+void RxBuffer::erase(size_t pos, size_t n)
+{
+	if (pos >= _len) return;
+	if (n > _len - pos) n = _len - pos;
+	std::memmove(_data + pos, _data + pos + n, _len - pos - n);
+	_len -= n;
+}
+
+ssize_t RxBuffer::readFrom(int fd)
+{
+	if (_len >= (size_t)LIMIT) { errno = ENOBUFS; return -1; }
+	size_t room = (size_t)LIMIT - _len;
+	BufferPool& pool = BufferPool::local();
+	reserve(1);
+	char* spare = pool.get();
+	struct iovec iov[2];
+	iov[0].iov_base = _data + _len;
+	iov[0].iov_len  = std::min(_cap - _len, room);
+	iov[1].iov_base = spare;
+	iov[1].iov_len  = std::min((size_t)BufferPool::BLOCK, room - iov[0].iov_len);
+	ssize_t n = ::readv(fd, iov, 2);
+	if (n > 0)
+	{
+		size_t own = std::min((size_t)n, _cap - _len);
+		_len += own;
+		if ((size_t)n > own) append(spare, (size_t)n - own);
+	}
+	pool.put(spare);
+	if (n <= 0) release();   // EAGAIN nach dem letzten Request: Block nicht festhalten
+	return n;
+}
@@ -0,0 +1,85 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RxBuffer.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:59:39 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 04:04:58 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef RXBUFFER_HPP
+# define RXBUFFER_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+// Pool fester Empfangsblöcke, einer pro Worker-Thread (kein Locking).
+// Freie Blöcke werden bis KEEP Stück aufgehoben, der Rest geht an den Heap.
+class BufferPool
+{
+	public:
+		enum { BLOCK = 16384, KEEP = 1024 };
+
+		static BufferPool& local();
+
+		char*  get();
+		void   put(char* b);
+		size_t idle() const { return _free.size(); }
+
+	private:
+		BufferPool() {}
+		~BufferPool();
+		BufferPool(const BufferPool&);
+		BufferPool& operator=(const BufferPool&);
+
+		std::vector<char*> _free;
+};
+
+// Empfangspuffer einer Verbindung. Normal liegt er in einem Block aus dem
+// Pool; nur große Header oder viele gepipelinete Requests wachsen auf den
+// Heap, höchstens bis LIMIT. release() gibt den Speicher zurück, sobald
+// nichts mehr drin liegt – eine Keep-Alive-Verbindung im Leerlauf hält
+// dann keinen Puffer mehr.
+class RxBuffer
+{
+	public:
+		enum { LIMIT = 4 * BufferPool::BLOCK };   // mehr ungeparste Bytes nimmt readFrom() nicht an
+
+		RxBuffer() : _data(NULL), _len(0), _cap(0), _heap(false) {}
+		~RxBuffer() { drop(); }
+
+		bool        empty() const { return _len == 0; }
+		size_t      size() const  { return _len; }
+		const char* data() const  { return _data; }
+		size_t find(const char* s, size_t pos) const { return std::string_view(_data, _len).find(s, pos); }
+		int    compare(size_t pos, size_t n, const char* s) const { return std::string_view(_data, _len).compare(pos, n, s); }
+
+		void append(const char* p, size_t n);
+		void erase(size_t pos, size_t n);
+		void clear() { _len = 0; }
+		void release() { if (_len == 0) drop(); }
+
+		// ein readv(): Rest des eigenen Blocks + ein geliehener Block aus
+		// dem Pool; nur was über den eigenen Block hinausgeht, wird kopiert.
+		// Rückgabe wie read(), -1/ENOBUFS wenn LIMIT erreicht ist
+		ssize_t readFrom(int fd);
+
+	private:
+		RxBuffer(const RxBuffer&);
+		RxBuffer& operator=(const RxBuffer&);
+
+		void reserve(size_t cap);
+		void drop();
+
+		char*  _data;
+		size_t _len;
+		size_t _cap;
+		bool   _heap;   // false: Block aus dem Pool
+};
+
+#endif
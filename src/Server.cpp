@@ -6,21 +6,37 @@
 /*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:36 by mhummel           #+#    #+#             */
-/*   Updated: 2025/10/29 11:35:41 by mhummel          ###   ########.fr       */
+/*   Updated: 2026/10/18 04:16:31 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "Server.hpp"
+#include "Logger.hpp"
 #include <unistd.h>
 #include <limits.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <thread>
 
 // globals
 static Config g_cfg;
-static std::vector<pollfd>     fds;
-static std::unordered_set<int> listener_fds;
-static std::vector<Client>     clients;
-static std::unordered_map<int /*port*/, std::vector<size_t> /*server indices*/> servers_by_port;
-static std::unordered_map<int /*lfd*/,  int /*port*/>      port_by_listener_fd;
+
+static long monotonic_ms()
+{
+    using clock_t = std::chrono::steady_clock;
+    using ms      = std::chrono::milliseconds;
+    return std::chrono::duration_cast<ms>(clock_t::now().time_since_epoch()).count();
+}
+
+// für Latenz-Histogramme (µs); clock_gettime läuft über den vDSO, kein Syscall
+static long monotonic_us()
+{
+    using clock_t = std::chrono::steady_clock;
+    using us      = std::chrono::microseconds;
+    return std::chrono::duration_cast<us>(clock_t::now().time_since_epoch()).count();
+}
 
 int make_nonblocking(int fd)
 {
@@ -28,26 +44,230 @@ int make_nonblocking(int fd)
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
-static void send_error_and_close(size_t i, int code, const std::string& text,
-                                 std::vector<pollfd>& fds, std::vector<Client>& clients)
+Server::Server(const Config& cfg, int id, bool reuseport)
+    : cfg(cfg), id(id), reuseport(reuseport), stats(Metrics::slot(id)),
+      reactor(Reactor::create(cfg.event_backend, cfg.edge_triggered)),
+      timers(monotonic_ms()), files(cfg.open_file_cache),
+      gzip(cfg.gzip ? new GzipCache(cfg.gzip_cache, cfg.gzip_cache_max_object) : NULL) {}
+
+Server::~Server()
 {
-    Client& c = clients[i];
-    std::string body = std::to_string(code) + " " + text + "\n";
-    c.tx = "HTTP/1.1 " + std::to_string(code) + " " + text + "\r\n"
-           "Content-Type: text/plain\r\n"
-           "Content-Length: " + std::to_string(body.size()) + "\r\n"
-           "Connection: close\r\n\r\n" + body;
-    fds[i].events |= POLLOUT;
+    clients.forEach([](uint64_t, Client& c) { ::close(c.fd); });
+    for (int lfd : listener_fds) ::close(lfd);
+    delete reactor;
 }
 
-inline void err400(size_t i, std::vector<pollfd>& fds, std::vector<Client>& clients){ send_error_and_close(i,400,"Bad Request",fds,clients); }
-inline void err413(size_t i, std::vector<pollfd>& fds, std::vector<Client>& clients){ send_error_and_close(i,413,"Payload Too Large",fds,clients); }
-inline void err505(size_t i, std::vector<pollfd>& fds, std::vector<Client>& clients){ send_error_and_close(i,505,"HTTP Version Not Supported",fds,clients); }
+// Interessen beim Reactor nur anfassen, wenn sie sich wirklich ändern
+void Server::set_events(Client& c, int events)
+{
+    if (c.events == events) return;
+    c.events = events;
+    reactor->modify(c.fd, events, c.id);
+}
 
-static void reset_for_next_request(Client& c)
+// noch etwas zu senden? (Header/Body-String oder Datei-Rest)
+static inline bool tx_pending(const Client& c)
 {
-    c.tx.clear();
-    c.rx.clear();
+    return !c.tx.empty();
+}
+
+// Timer passend zur Phase der Verbindung setzen. Header-Timeout läuft ab
+// dem ersten Byte (nicht pro read), Body- und Send-Timeout werden bei
+// jedem Fortschritt neu gestartet, Keep-Alive-Idle nach jeder Antwort.
+void Server::update_timer(Client& c, long now_ms, bool progress)
+{
+    Phase p;
+    if (c.cgi)                                   p = Phase::CGI;
+    else if (tx_pending(c))                      p = Phase::SEND;
+    else if (c.state == RxState::READING_BODY)   p = Phase::BODY;
+    else if (c.rx.empty() && c.requests > 0)     p = Phase::IDLE;
+    else                                         p = Phase::HEADER;
+
+    if (p == c.phase && !(progress && (p == Phase::BODY || p == Phase::SEND)))
+        return;
+    c.phase = p;
+
+    const ServerConfig& sc = cfg.servers[c.server_idx];
+    long t = sc.header_timeout;
+    if (p == Phase::BODY)      t = sc.body_timeout;
+    else if (p == Phase::IDLE) t = sc.keepalive_timeout;
+    else if (p == Phase::SEND) t = sc.send_timeout;
+    else if (p == Phase::CGI)  t = c.cgi->timeout;    // Gesamtlaufzeit, nicht pro Ausgabe
+    timers.schedule(c.id, now_ms + t);
+}
+
+void Server::on_timeout(uint64_t cid)
+{
+    Client* cp = clients.get(cid);
+    if (!cp) return;
+    Client& c = *cp;
+    static const char* names[] = { "none", "header", "body", "idle", "send", "cgi" };
+    logMsg(LogLevel::INFO, "timeout fd=%d phase=%s", c.fd, names[(int)c.phase]);
+    WorkerMetrics::add(stats.timeouts[(int)c.phase]);
+
+    // hängendes Script: killen und 504 (ist die Antwort schon unterwegs, nur zumachen)
+    if (c.phase == Phase::CGI && c.cgi) {
+        if (c.cgi->stream.headerSent()) {
+            close_client(c);
+            return;
+        }
+        stop_cgi(c, true);
+        send_error_and_close(c, 504, "Gateway Timeout");
+        update_timer(c, monotonic_ms(), true);
+        return;
+    }
+
+    // angefangenen Request mit 408 beantworten, sonst einfach zumachen
+    bool partial = (c.phase == Phase::HEADER && !c.rx.empty()) || c.phase == Phase::BODY;
+    if (partial && !tx_pending(c)) {
+        send_error_and_close(c, 408, "Request Timeout");
+        update_timer(c, monotonic_ms(), true);
+        return;
+    }
+    close_client(c);
+}
+
+// Anführungszeichen, Backslash und Steuerzeichen maskieren (combined: \xHH wie nginx)
+static void append_escaped(std::string& out, std::string_view s, bool json)
+{
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        unsigned char ch = (unsigned char)s[i];
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += (char)ch;
+        } else if (ch < 0x20 || ch == 0x7f || (!json && ch >= 0x80)) {
+            out += json ? "\\u00" : "\\x";
+            out += hex[ch >> 4];
+            out += hex[ch & 15];
+        } else
+            out += (char)ch;
+    }
+}
+
+// Antwort liegt komplett in tx: Metriken zählen und eine Access-Log-Zeile
+// (Zeit setzt der Logger ein)
+static void response_done(Client& c, WorkerMetrics& stats)
+{
+    Logger& log = Logger::get();
+    size_t bytes = c.tx.total() - c.tx_mark;
+    c.tx_mark = c.tx.total();
+    int status = c.status;
+    c.status = 0;
+    if (status == 0) return;
+
+    long now = monotonic_us();
+    stats.request(c.method, status);
+    if (c.t_ready) stats.latency[WorkerMetrics::P_HANDLER].record(now - c.t_ready);
+    if (!c.t_queued) c.t_queued = now;   // Write-Phase läuft ab hier
+    if (!log.accessOn()) return;
+
+    std::string_view ref = c.req.headers.get("Referer");
+    std::string_view ua  = c.req.headers.get(H_USER_AGENT);
+    std::string line;
+    line.reserve(256 + c.target.size() + c.req.query.size() + ref.size() + ua.size());
+    size_t split;
+    if (log.accessFormat() == Logger::JSON)
+    {
+        line += "{\"time\":\"";
+        split = line.size();
+        line += "\",\"remote_addr\":\"";
+        line += c.remote;
+        line += "\",\"method\":\"";
+        append_escaped(line, c.method, true);
+        line += "\",\"uri\":\"";
+        append_escaped(line, c.target, true);
+        if (!c.req.query.empty()) { line += '?'; append_escaped(line, c.req.query, true); }
+        line += "\",\"protocol\":\"";
+        append_escaped(line, c.version, true);
+        line += "\",\"status\":" + std::to_string(status);
+        line += ",\"bytes_sent\":" + std::to_string(bytes);
+        line += ",\"referer\":\"";
+        append_escaped(line, ref, true);
+        line += "\",\"user_agent\":\"";
+        append_escaped(line, ua, true);
+        line += "\",\"request_time_ms\":";
+        line += std::to_string(c.t_head ? (now - c.t_head) / 1000 : 0);
+        line += '}';
+    }
+    else
+    {
+        // combined: addr - - [zeit] "request" status bytes "referer" "user-agent"
+        line += c.remote.empty() ? "-" : c.remote;
+        line += " - - [";
+        split = line.size();
+        line += "] \"";
+        if (c.method.empty()) line += '-';
+        else {
+            append_escaped(line, c.method, false);
+            line += ' ';
+            append_escaped(line, c.target, false);
+            if (!c.req.query.empty()) { line += '?'; append_escaped(line, c.req.query, false); }
+            line += ' ';
+            append_escaped(line, c.version, false);
+        }
+        line += "\" " + std::to_string(status) + " " + std::to_string(bytes) + " \"";
+        if (ref.empty()) line += '-'; else append_escaped(line, ref, false);
+        line += "\" \"";
+        if (ua.empty()) line += '-'; else append_escaped(line, ua, false);
+        line += '"';
+    }
+    log.access(line, split);
+}
+
+// O(1): Slot wird nur freigegeben, andere Clients bleiben wo sie sind
+void Server::close_client(Client& c)
+{
+    // abgebrochene CGI-Antwort (Header schon raus) trotzdem loggen
+    if (c.cgi && c.cgi->stream.headerSent()) c.status = c.cgi->stream.status();
+    response_done(c, stats);
+    WorkerMetrics::add(stats.closed);
+    if (c.cgi) stop_cgi(c, true);
+    timers.cancel(c.id);
+    reactor->remove(c.fd);
+    ::close(c.fd);
+    clients.erase(c.id);
+}
+
+void Server::send_error_and_close(Client& c, int code, const std::string& text, const std::string& extra)
+{
+    std::string body = std::to_string(code) + " " + text + "\n";
+    c.tx.append("HTTP/1.1 " + std::to_string(code) + " " + text + "\r\n" + extra +
+                "Content-Type: text/plain\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body);
+    c.keep_alive = false;
+    c.closing    = true;
+    c.status     = code;
+    response_done(c, stats);
+    set_events(c, c.events | EV_WRITE);
+    stop_reading(c);
+}
+
+// Request ist beantwortet (Antwort steht in tx): Zustand für den nächsten
+// zurücksetzen. Was hinter dem Request schon in rx liegt (Pipelining),
+// bleibt stehen und wird als nächster Request geparst.
+static void reset_for_next_request(Client& c, WorkerMetrics& stats)
+{
+    response_done(c, stats);
+    c.rx.erase(0, c.rx_off);
+    c.rx_off = 0;
+    c.rx.release();   // nichts Gepipelinetes dahinter: Block zurück in den Pool
+    c.t_first = c.rx.empty() ? 0 : monotonic_us();   // gepipelineter Request ist schon da
+    c.t_ready = 0;
+    c.requests++;
+    c.loc = NULL;
+    c.method.clear();
+    c.target.clear();
+    c.t_head = 0;
+    if (!c.keep_alive) c.closing = true;
+    c.parser.reset();
+    // Request neu in der geleerten Arena anlegen (kein Move-Assign: das
+    // würde in die alte Arena kopieren statt sie freizugeben)
+    c.req.~Request();
+    c.arena.release();
+    new (&c.req) Request(c.arena.resource());
     c.state = RxState::READING_HEADERS;
     c.header_done = false;
     c.is_chunked = false;
@@ -57,311 +277,1044 @@ static void reset_for_next_request(Client& c)
     c.ch_need  = 0;
 }
 
-static int add_listener(uint16_t port)
+static const char* reason_phrase(int code)
 {
-    int s = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (s < 0) { perror("socket"); return -1; }
-    int yes = 1;
-    if (::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0) {
-        perror("setsockopt"); ::close(s); return -1;
+    switch (code)
+    {
+        case 400: return "Bad Request";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        case 505: return "HTTP Version Not Supported";
+        default:  return "Error";
     }
+}
 
-    sockaddr_in a{};
-    a.sin_family      = AF_INET;
-    a.sin_addr.s_addr = htonl(INADDR_ANY);
-    a.sin_port        = htons(port);
+static inline int hexval(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    return (ch | 0x20) - 'a' + 10;
+}
 
-    if (::bind(s, (sockaddr*)&a, sizeof(a)) < 0) { perror("bind"); ::close(s); return -1; }
-    if (::listen(s, 128) < 0)                     { perror("listen"); ::close(s); return -1; }
-    if (make_nonblocking(s) < 0)                  { perror("fcntl");  ::close(s); return -1; }
+// verarbeitet so viel wie möglich ab c.rx_off, de-chunked nach 'out'.
+// 1 = fertig, 0 = braucht mehr Daten, sonst HTTP-Fehlercode (400/413/500).
+// Das Limit wird schon beim Chunk-Header geprüft, nicht erst am Ende.
+static int dechunk_step(Client& c, RequestBody& out)
+{
+    using CS = Client::ChunkState;
+    for (;;)
+    {
+        if (c.ch_state == CS::SIZE || c.ch_state == CS::TRAILER)
+        {
+            size_t p = c.rx.find("\r\n", c.rx_off);
+            if (p == std::string::npos)
+                return (c.rx.size() - c.rx_off > 4096) ? 400 : 0;
+            if (c.ch_state == CS::TRAILER) {
+                // Trailer-Felder überspringen bis zur Leerzeile
+                bool empty = (p == c.rx_off);
+                c.rx_off = p + 2;
+                if (empty) { c.ch_state = CS::DONE; return 1; }
+                continue;
+            }
+            // hex size; optionale chunk extensions ignorieren
+            const char* q = c.rx.data() + c.rx_off;
+            const char* e = c.rx.data() + p;
+            const char* start = q;
+            size_t n = 0;
+            for (; q < e && isxdigit((unsigned char)*q); ++q) {
+                if (n > (SIZE_MAX >> 4)) return 413;
+                n = n * 16 + hexval(*q);
+            }
+            if (q == start || (q < e && *q != ';' && *q != ' ' && *q != '\t')) return 400;
+            if (n > c.max_body_bytes - c.body_rcvd) return 413;
+            c.rx_off = p + 2;
+            c.ch_need = n;
+            c.ch_state = (n == 0) ? CS::TRAILER : CS::DATA;
+        }
+        if (c.ch_state == CS::DATA)
+        {
+            size_t take = std::min(c.rx.size() - c.rx_off, c.ch_need);
+            if (!out.append(c.rx.data() + c.rx_off, take)) return 500;
+            c.rx_off += take; c.ch_need -= take; c.body_rcvd += take;
+            if (c.ch_need > 0) return 0;
+            c.ch_state = CS::CRLF_AFTER_DATA;
+        }
+        if (c.ch_state == CS::CRLF_AFTER_DATA)
+        {
+            if (c.rx.size() - c.rx_off < 2) return 0;
+            if (c.rx.compare(c.rx_off, 2, "\r\n") != 0) return 400;
+            c.rx_off += 2;
+            c.ch_state = CS::SIZE;
+        }
+        if (c.ch_state == CS::DONE) return 1;
+    }
+}
 
-    pollfd p{}; p.fd = s; p.events = POLLIN; p.revents = 0;
-    fds.push_back(p);
-    clients.push_back(Client{}); // Dummy, hält Index-Sync
-    listener_fds.insert(s);
+// vHost per Host-Header (ohne :port) unter den Servern dieses Ports wählen
+void Server::select_server(Client& c)
+{
+    const std::vector<size_t>& cand = servers_by_port[c.listen_port];
+    for (size_t i = 0; i < cand.size(); ++i)
+        if (!c.host.empty() && cfg.servers[cand[i]].server_name == c.host) {
+            c.server_idx = cand[i];
+            return;
+        }
+    c.server_idx = cand.front();
+}
 
-    std::cout << "Listening on 0.0.0.0:" << port << "\n";
-    return s;
+// so viel Antwort darf im Speicher warten, bevor weitere gepipelinete
+// Requests liegen bleiben, bis der Client aufgeholt hat; solange wird auch
+// nicht weitergelesen (der Kernel-Puffer bremst den Client)
+static const size_t PIPELINE_TX_MAX = 256 * 1024;
+
+// Zustandsmaschine pro Verbindung: Header inkrementell parsen (der Parser
+// macht beim nächsten read dort weiter, wo er war), dann den Body per
+// Content-Length oder chunked aus c.rx holen, dann dispatchen.
+// Mit Pipelining liegen mehrere Requests hintereinander in c.rx: sie werden
+// der Reihe nach abgearbeitet, die Antworten hängen in derselben Reihenfolge
+// in c.tx. Ein CGI hält die Schlange an, bis seine Antwort komplett ist.
+// Während die Schlange steht, ist EV_READ aus: weder rx noch der Timer
+// wachsen mit, was der Client nachschiebt. Wieder an geht es, wenn tx leer
+// ist bzw. das CGI fertig (beide rufen hier wieder rein).
+void Server::process_input(Client& c)
+{
+    while (!c.cgi && !c.closing && c.tx.buffered() < PIPELINE_TX_MAX)
+    {
+        if (c.state == RxState::READING_HEADERS && c.rx.empty())
+            break;
+        if (!process_request(c))
+            break;
+    }
+    if (c.closing)
+        stop_reading(c);
+    else if (c.cgi || c.tx.buffered() >= PIPELINE_TX_MAX)
+        set_events(c, c.events & ~EV_READ);
+    else
+        set_events(c, c.events | EV_READ);
 }
 
+// Antwort mit "Connection: close" steht in tx: was der Client noch
+// nachschiebt (Rest eines abgelehnten Bodys, weitere Requests), wird
+// nicht mehr gelesen und nicht gepuffert
+void Server::stop_reading(Client& c)
+{
+    set_events(c, c.events & ~EV_READ);
+    c.rx.clear();
+    c.rx.release();
+    c.rx_off = 0;
+}
 
+// ein Request aus c.rx; true = beantwortet, der nächste kann kommen
+bool Server::process_request(Client& c)
+{
+    if (c.state == RxState::READING_HEADERS)
+    {
+        RequestParser::Status st = c.parser.feed(c.rx.data(), c.rx.size(), c.max_header_bytes);
+        if (st == RequestParser::NEED_MORE) return false;
+        if (st == RequestParser::ERROR) {
+            send_error_and_close(c, c.parser.error(), reason_phrase(c.parser.error()));
+            return false;
+        }
+        c.header_done = true;
+        c.t_head = monotonic_us();
+        if (c.t_first) stats.latency[WorkerMetrics::P_HEADER].record(c.t_head - c.t_first);
+        if (!c.parser.build(c.req)) { err400(c); return false; }
 
+        c.method.assign(c.req.method);
+        c.target.assign(c.req.path);
+        c.version.assign(c.req.version);
+        c.keep_alive  = c.req.keep_alive;
+        c.is_chunked  = c.req.is_chunked;
+        c.content_len = c.req.content_len;
+        bool has_host = false;
+        std::string_view host = c.parser.header("Host", &has_host);
+        if (!has_host && c.version == "HTTP/1.1") { err400(c); return false; }
+        c.host.assign(host.substr(0, host.find(':')));
+        select_server(c);
+        // Limits an finalen Server anpassen
+        const ServerConfig& sc = cfg.servers[c.server_idx];
+        c.loc = &sc.locations[sc.router.match(c.target)];
 
+        // Methode nicht erlaubt: 405, bevor ein Body-Byte gepuffert wird
+        if (!c.loc->policy->allows(c.req.method)) { err405(c); return false; }
+        c.max_body_bytes = sc.client_max_body_size;
+        c.req.body.setSpill(sc.client_body_buffer_size, cfg.client_body_temp_path);
 
+        // zu groß angekündigt: sofort 413, bevor ein Body-Byte gepuffert wird
+        if (!c.is_chunked && c.content_len > c.max_body_bytes) { err413(c); return false; }
 
+        c.rx_off = c.parser.consumed();
+        c.state = (c.is_chunked || c.content_len > 0) ? RxState::READING_BODY : RxState::READY;
 
+        // Client wartet auf unser OK, bevor er den Body schickt; es geht wie
+        // jede Antwort durch tx, also hinter evtl. noch ausstehenden Antworten
+        std::string_view expect = c.parser.header("Expect");
+        if (c.state == RxState::READING_BODY && expect.size() == 12
+            && strncasecmp(expect.data(), "100-continue", 12) == 0 && c.rx_off == c.rx.size()) {
+            static const std::shared_ptr<const std::string> cont =
+                std::make_shared<const std::string>("HTTP/1.1 100 Continue\r\n\r\n");
+            c.tx.append(cont);
+            set_events(c, c.events | EV_WRITE);
+        }
+    }
 
+    if (c.state == RxState::READING_BODY)
+    {
+        if (c.is_chunked) {
+            int r = dechunk_step(c, c.req.body);
+            if (r > 1) { send_error_and_close(c, r, reason_phrase(r)); return false; }
+            if (r == 0) { c.rx.erase(0, c.rx_off); c.rx_off = 0; return false; }
+        } else {
+            // Body-Bytes direkt weiterreichen (Speicher oder Temp-Datei), rx bleibt klein
+            size_t take = std::min(c.rx.size() - c.rx_off, c.content_len - c.body_rcvd);
+            if (!c.req.body.append(c.rx.data() + c.rx_off, take)) { send_error_and_close(c, 500, reason_phrase(500)); return false; }
+            c.rx_off += take; c.body_rcvd += take;
+            if (c.body_rcvd < c.content_len) { c.rx.clear(); c.rx_off = 0; return false; }
+        }
+        c.state = RxState::READY;
+    }
 
+    dispatch(c);
+    if (c.cgi || c.closing)
+        return false;   // CGI antwortet später, bzw. Fehler/close
+    reset_for_next_request(c, stats);
+    return true;
+}
 
+// Response-Cache der Location: bei Treffer hängen die gespeicherten Puffer in c.tx.
+// key wird gesetzt, wenn die Antwort danach gespeichert werden darf.
+bool Server::serve_cached(Client& c, const LocationConfig& lc, std::string& key)
+{
+    if (lc.response_cache_size == 0 || files.fd() < 0 || c.req.method != "GET")
+        return false;   // ohne inotify (open_file_cache off) gäbe es keine Invalidierung
+    // bedingte und partielle Requests gehen immer durch den Handler
+    if (c.req.headers.has(H_IF_NONE_MATCH) || c.req.headers.has(H_IF_MODIFIED_SINCE)
+        || c.req.headers.has(H_RANGE) || c.req.headers.has(H_IF_RANGE))
+        return false;
 
+    std::unique_ptr<ResponseCache>& rc = rcache[&lc];
+    if (!rc) rc.reset(new ResponseCache(lc.response_cache_size, lc.response_cache_max_object));
 
-int main(int argc, char** argv)
+    // die Antwort hängt vom Keep-Alive-Header und von Accept-Encoding ab, beides steckt mit im Key
+    key = c.target;
+    key += c.req.keep_alive ? "\nka\n" : "\nclose\n";
+    key += c.req.headers.get(H_ACCEPT_ENCODING);
+    const ResponseCache::Entry* e = rc->lookup(key);
+    if (!e) { WorkerMetrics::add(stats.cache_misses); return false; }
+    WorkerMetrics::add(stats.cache_hits);
+
+    static const std::shared_ptr<const std::string> hit = std::make_shared<const std::string>("X-Cache: HIT\r\n\r\n");
+    c.keep_alive = c.req.keep_alive;
+    c.status = 200;
+    c.tx.append(e->head);
+    c.tx.append(hit);
+    c.tx.append(e->body);
+    key.clear();
+    return true;
+}
+
+void Server::dispatch(Client& c)
 {
-    // === 1. AUTOMATISCHER CONFIG-PFAD ===
-    const char* cfg_path = "./config/webserv.conf";
-    if (argc > 1) {
-        cfg_path = argv[1];  // Optional: ./webserv my.conf
+    const LocationConfig& lc = *c.loc;
+    c.t_ready = monotonic_us();
+    if (lc.metrics)
+    {
+        serve_metrics(c);
+        return;
     }
 
-    // === 2. CONFIG LADEN MIT FALLBACK ===
-    try {
-        g_cfg.parse_c(cfg_path);
-        std::cout << "Config geladen: " << cfg_path << "\n";
-    } catch (const std::exception& e) {
-        std::cerr << "Config-Fehler (" << cfg_path << "): " << e.what() << "\n";
-        std::cerr << "→ Starte mit Default-Server auf 127.0.0.1:8080\n";
+    std::string cache_key;
+    if (serve_cached(c, lc, cache_key))
+    {
+        set_events(c, c.events | EV_WRITE);
+        return;
+    }
+    c.req.conn_fd = c.fd;
+    ResponseHandler handler(&files, gzip.get());
+    Response res = handler.handleRequest(c.req, lc);
+    if (!res.cgi_script.empty())
+    {
+        start_cgi(c, lc, res.cgi_script);
+        return;
+    }
+    if (!cache_key.empty() && rcache[&lc]->store(cache_key, res))
+        res.headers.set(H_X_CACHE, "MISS");
+    send_response(c, res);
+}
 
-        // --- DEFAULT-SERVER MANUELL ANLEGEN ---
-        ServerConfig defaultServer;
-        defaultServer.listen_host = "127.0.0.1";
-        defaultServer.listen_port = 8080;
-        defaultServer.server_name = "default";
-        defaultServer.client_max_body_size = 1048576;  // 1MB
+// fertige Response in die Sendewarteschlange: Header und body als eigene
+// Segmente (body wird verschoben, blob geteilt, nichts kopiert), Datei-Teile per sendfile()
+void Server::send_response(Client& c, Response& res)
+{
+    c.keep_alive = c.req.keep_alive && res.keep_alive; // Server-Core entscheidet final über close/keep-alive
+    c.status = res.statusCode;
+    c.tx.append(res.head());
+    c.tx.append(std::move(res.body));
+    if (res.blob)
+        c.tx.append(res.blob);
+    if (res.file && (res.file_len > 0 || !res.parts.empty()))
+    {
+        // Header und erste Datei-Bytes zusammen in volle Segmente packen
+        int on = 1;
+        c.corked = (::setsockopt(c.fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on)) == 0);
+        c.tx.appendFile(res.file, res.file_off, res.file_len);
+        // Multi-Range: Trenner und Bereich abwechselnd
+        for (size_t i = 0; i < res.parts.size(); ++i) {
+            c.tx.append(std::move(res.parts[i].prefix));
+            c.tx.appendFile(res.file, res.parts[i].off, res.parts[i].len);
+        }
+    }
+    set_events(c, c.events | EV_WRITE);
+}
 
-        LocationConfig defaultLoc;
-        defaultLoc.path = "/";
-        defaultLoc.root = "./html";
-        defaultLoc.index = "index.html";
-        defaultLoc.autoindex = true;
-        defaultLoc.methods = {"GET", "POST", "DELETE"};
+// Location mit "metrics on": Zähler aller Worker im Prometheus-Textformat
+void Server::serve_metrics(Client& c)
+{
+    Response res(c.req.headers.resource());
+    res.statusCode   = 200;
+    res.reasonPhrase = "OK";
+    res.keep_alive   = c.req.keep_alive;
+    res.body = Metrics::render();
+    res.headers.set(H_SERVER, "webserv/1.0");
+    res.headers.set(H_CONTENT_TYPE, "text/plain; version=0.0.4; charset=utf-8");
+    res.headers.set(H_CONTENT_LENGTH, std::to_string(res.body.size()));
+    res.headers.set("Cache-Control", "no-store");
+    send_response(c, res);
+}
 
-        defaultServer.locations.push_back(defaultLoc);
-        g_cfg.servers.push_back(defaultServer);
+// Warteschlange abarbeiten, bis sie leer ist oder der Socket voll.
+// false = Verbindung kaputt, schließen.
+bool Server::flush_tx(Client& c, long now_ms)
+{
+    while (!c.tx.empty())
+	{
+        ssize_t m = c.tx.send(c.fd);
+        if (m > 0) { WorkerMetrics::add(stats.bytes_out, m); update_timer(c, now_ms, true); continue; }
+        if (m < 0 && (errno==EAGAIN || errno==EWOULDBLOCK)) return true;
+        if (m < 0 && errno == EINTR) continue;
+        if (m == 0) logMsg(LogLevel::WARN, "sendfile: file shrank while sending");
+        else        logMsg(LogLevel::INFO, "send: %s", strerror(errno));
+        return false;
+    }
+    if (c.corked)
+	{
+        int off = 0;
+        ::setsockopt(c.fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+        c.corked = false;
     }
+    // alles raus: Zeit seit der ersten wartenden Antwort
+    if (c.t_queued) {
+        stats.latency[WorkerMetrics::P_WRITE].record(monotonic_us() - c.t_queued);
+        c.t_queued = 0;
+    }
+    return true;
+}
 
-    // === 3. DEFAULTS FÜR ALLE SERVER/LOCATIONS SETZEN ===
-    for (auto& server : g_cfg.servers) {
-        if (server.listen_port == 0) server.listen_port = 80;
-        if (server.client_max_body_size == 0) server.client_max_body_size = 1048576;
-        if (server.error_pages.empty()) server.error_pages = g_cfg.default_error_pages;
+// ---- CGI als asynchroner Sub-Request ------------------------------------
+// Das Script läuft neben dem Event-Loop: stdin/stdout-Pipes und ein pidfd
+// hängen am Reactor, ein langsames Script blockiert keine anderen Clients.
 
-        for (auto& loc : server.locations) {
-            if (loc.index.empty()) loc.index = "index.html";
-            if (loc.methods.empty()) loc.methods = {"GET", "POST", "DELETE"};
-            if (loc.error_pages.empty()) loc.error_pages = server.error_pages;
-            if (!loc.autoindex) loc.autoindex = false;
+// mehr Script-Ausgabe wird nicht gepuffert, wenn der Client langsamer liest
+static const size_t CGI_TX_MAX = 256 * 1024;
+
+void Server::start_cgi(Client& c, const LocationConfig& lc, const std::string& script)
+{
+    // Interpreter kommt aus "cgi .py /usr/bin/python3" der Location; ohne
+    // Eintrag wird das Script selbst ausgeführt (Shebang)
+    static const std::string none;
+    const std::string* interpreter = lc.policy->cgiFor(script);
+    if (!interpreter) interpreter = &none;
+    // "cgi .php fastcgi://127.0.0.1:9000": an den Worker-Pool statt eigenem Prozess
+    if (FcgiPool::isFastCgi(*interpreter)) {
+        start_fastcgi(c, lc, script, *interpreter);
+        return;
+    }
+
+    CGIHandler handler;
+    CgiProcess p;
+    if (!handler.spawn(c.req, script, *interpreter, lc.policy->cgi_env, p)) {
+        send_error_and_close(c, 502, reason_phrase(502));
+        return;
+    }
+    WorkerMetrics::add(stats.cgi_spawns);
+    c.cgi.reset(new CgiJob());
+    c.cgi->pid     = p.pid;
+    c.cgi->in_fd   = p.in_fd;
+    c.cgi->out_fd  = p.out_fd;
+    c.cgi->timeout = lc.cgi_timeout;
+    c.cgi->stream.setClient(c.req.version != "HTTP/1.0", c.req.keep_alive);
+
+    reactor->add(p.out_fd, EV_READ, FD_TAG | (uint64_t)p.out_fd);
+    cgi_fds[p.out_fd] = c.id;
+    if (p.in_fd >= 0) {
+        reactor->add(p.in_fd, EV_WRITE, FD_TAG | (uint64_t)p.in_fd);
+        cgi_fds[p.in_fd] = c.id;
+    }
+    c.cgi->pidfd = watch_child(p.pid, c.id);
+    update_timer(c, monotonic_ms(), true);
+}
+
+void Server::start_fastcgi(Client& c, const LocationConfig& lc, const std::string& script, const std::string& upstream)
+{
+    std::unique_ptr<FcgiPool>& pool = fcgi_pools[upstream];
+    if (!pool) pool.reset(new FcgiPool(upstream, lc.fastcgi_max_conns, reactor, FD_TAG, cfg.client_body_temp_path));
+    if (!pool->valid()) {
+        send_error_and_close(c, 502, reason_phrase(502));
+        return;
+    }
+
+    // der Upstream hat ein anderes Arbeitsverzeichnis: Script-Pfad absolut
+    static const std::string cwd = [] { char b[PATH_MAX]; return std::string(getcwd(b, sizeof(b)) ? b : "."); }();
+    CGIHandler handler;
+    std::map<std::string, std::string> params = handler.buildEnv(c.req, script, lc.policy->cgi_env);
+    if (!script.empty() && script[0] != '/')
+        params["SCRIPT_FILENAME"] = cwd + "/" + (script.compare(0, 2, "./") == 0 ? script.substr(2) : script);
+
+    c.cgi.reset(new CgiJob());
+    c.cgi->fcgi    = pool.get();
+    c.cgi->timeout = lc.cgi_timeout;
+    c.cgi->stream.setClient(c.req.version != "HTTP/1.0", c.req.keep_alive);
+    update_timer(c, monotonic_ms(), true);
+    WorkerMetrics::add(stats.fastcgi_requests);
+    pool->submit(c.id, params, &c.req.body, fcgi_done);
+}
+
+// FastCGI-Ausgabe (gesammelt während der Events) an ihre Clients
+void Server::handle_fcgi_done(long now_ms)
+{
+    std::vector<FcgiResult> done;
+    done.swap(fcgi_done);
+    for (size_t i = 0; i < done.size(); ++i)
+    {
+        Client* cp = clients.get(done[i].client);
+        if (!cp || !cp->cgi || !cp->cgi->fcgi) continue;
+        Client& c = *cp;
+        if (done[i].status) {
+            if (c.cgi->stream.headerSent()) { close_client(c); continue; }
+            stop_cgi(c, false);
+            send_error_and_close(c, done[i].status, reason_phrase(done[i].status));
+            update_timer(c, now_ms, true);
+            continue;
+        }
+        if (!cgi_output(c, done[i].out.data(), done[i].out.size())) {
+            cgi_failed(c, now_ms);
+            continue;
+        }
+        if (done[i].final)
+            finish_cgi(c, now_ms);
+    }
+}
+
+// Event auf einem fd, der kein Client/Listener ist: CGI-Pipe, pidfd oder FastCGI-Verbindung
+void Server::on_fd_event(int fd, int ev, long now_ms)
+{
+    for (std::unordered_map<std::string, std::unique_ptr<FcgiPool> >::iterator p = fcgi_pools.begin(); p != fcgi_pools.end(); ++p)
+        if (p->second->owns(fd)) {
+            p->second->onEvent(fd, ev, fcgi_done);
+            return;
         }
+
+    std::unordered_map<int, CgiChild>::iterator ch = children.find(fd);
+    if (ch != children.end()) {
+        if (::waitpid(ch->second.pid, NULL, WNOHANG) != 0) {
+            reaped(ch->second);
+            reactor->remove(fd);
+            ::close(fd);
+            children.erase(ch);
+        }
+        return;
+    }
+    std::unordered_map<int, uint64_t>::iterator it = cgi_fds.find(fd);
+    if (it == cgi_fds.end()) return;
+    Client* cp = clients.get(it->second);
+    if (!cp || !cp->cgi) return;
+    Client& c = *cp;
+    // HUP auf stdout heißt nur "Script hat zugemacht": Rest lesen, dann EOF
+    if (fd == c.cgi->out_fd && (ev & (EV_READ | EV_ERROR)))
+        cgi_read(c, now_ms);
+    else if (fd == c.cgi->in_fd && (ev & (EV_WRITE | EV_ERROR)))
+        cgi_write(c);
+}
+
+void Server::cgi_read(Client& c, long now_ms)
+{
+    char buf[16384];
+    for (;;)
+    {
+        ssize_t n = ::read(c.cgi->out_fd, buf, sizeof(buf));
+        if (n > 0) {
+            if (!cgi_output(c, buf, n)) { cgi_failed(c, now_ms); return; }
+            // Client kommt nicht hinterher: stdout erst wieder lesen, wenn tx leer ist
+            if (c.tx.buffered() >= CGI_TX_MAX) {
+                reactor->remove(c.cgi->out_fd);
+                c.cgi->paused = true;
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        break;   // EOF oder Fehler: Script ist fertig
+    }
+    finish_cgi(c, now_ms);
+}
+
+// Body aus dem Speicher häppchenweise in die stdin-Pipe
+void Server::cgi_write(Client& c)
+{
+    CgiJob& job = *c.cgi;
+    std::string_view body = c.req.body.view();
+    while (job.in_off < body.size())
+    {
+        ssize_t n = ::write(job.in_fd, body.data() + job.in_off, body.size() - job.in_off);
+        if (n > 0) { job.in_off += n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        break;   // EPIPE: Script liest stdin nicht (mehr)
+    }
+    reactor->remove(job.in_fd);
+    cgi_fds.erase(job.in_fd);
+    ::close(job.in_fd);
+    job.in_fd = -1;
+}
+
+// Script-Ausgabe durch den CgiStream in den tx-Puffer; der Header geht
+// raus, sobald er komplett ist, danach jeder Body-Happen. false = kaputter Header
+bool Server::cgi_output(Client& c, const char* data, size_t n)
+{
+    std::string out;
+    if (!c.cgi->stream.feed(data, n, out))
+        return false;
+    c.tx.append(std::move(out));
+    if (!c.tx.empty() && !(c.events & EV_WRITE))
+        set_events(c, c.events | EV_WRITE);
+    return true;
+}
+
+void Server::finish_cgi(Client& c, long now_ms)
+{
+    CgiJob& job = *c.cgi;
+    std::string tail;
+    if (!job.stream.finish(tail)) {
+        cgi_failed(c, now_ms);   // EOF vor dem Ende des Header-Blocks
+        return;
     }
+    c.tx.append(std::move(tail));
+    c.keep_alive = job.stream.keepAlive();
+    c.status = job.stream.status();
+    stop_cgi(c, false);   // Script hat stdout zu; das Reapen übernimmt der pidfd
+    set_events(c, c.events | EV_WRITE);
+    // Antwort ist komplett: gepipelinete Requests dahinter dürfen weiter
+    reset_for_next_request(c, stats);
+    process_input(c);
+    update_timer(c, now_ms, true);
+}
+
+// Script liefert keinen brauchbaren Header: 502
+void Server::cgi_failed(Client& c, long now_ms)
+{
+    stop_cgi(c, true);
+    send_error_and_close(c, 502, reason_phrase(502));
+    update_timer(c, now_ms, true);
+}
+
+// Pipes abmelden und schließen; bei kill_child wird ein noch laufendes
+// Script gekillt (Timeout, Client weg)
+void Server::stop_cgi(Client& c, bool kill_child)
+{
+    CgiJob& job = *c.cgi;
+    int fds[2] = { job.in_fd, job.out_fd };
+    for (int i = 0; i < 2; ++i) {
+        if (fds[i] < 0) continue;
+        if (!(fds[i] == job.out_fd && job.paused))
+            reactor->remove(fds[i]);
+        cgi_fds.erase(fds[i]);
+        ::close(fds[i]);
+    }
+    if (kill_child && job.fcgi)
+        job.fcgi->abort(c.id, fcgi_done);
+    // nur ein noch nicht reaptes Kind killen: über den pidfd trifft das
+    // Signal sicher diesen Prozess; ohne pidfd ist die pid bis zum Reapen
+    // (reaped() setzt sie auf -1) noch unsere
+    if (kill_child && job.pidfd >= 0)
+        ::syscall(SYS_pidfd_send_signal, job.pidfd, SIGKILL, NULL, 0);
+    else if (kill_child && job.pid > 0)
+        ::kill(job.pid, SIGKILL);
+    c.cgi.reset();
+}
+
+// Kind über pidfd im Reactor beobachten; ohne pidfd_open (Kernel < 5.3)
+// sammelt reap_children() es bei jedem Loop-Durchlauf ein. Gibt den pidfd
+// zurück (-1 ohne), er bleibt bis zum Reapen offen.
+int Server::watch_child(pid_t pid, uint64_t client)
+{
+    CgiChild child = { pid, client };
+    int pfd = (int)::syscall(SYS_pidfd_open, pid, 0);
+    if (pfd >= 0 && reactor->add(pfd, EV_READ, FD_TAG | (uint64_t)pfd)) {
+        children[pfd] = child;
+        return pfd;
+    }
+    if (pfd >= 0) ::close(pfd);
+    zombies.push_back(child);
+    return -1;
+}
+
+// Kind ist weg: ein noch laufender CgiJob darf pid/pidfd nicht mehr benutzen
+void Server::reaped(const CgiChild& child)
+{
+    Client* cp = clients.get(child.client);
+    if (cp && cp->cgi && cp->cgi->pid == child.pid) {
+        cp->cgi->pid   = -1;
+        cp->cgi->pidfd = -1;
+    }
+}
 
-    // === 4. LISTENER AUS CONFIG STARTEN ===
+void Server::reap_children()
+{
+    for (size_t i = 0; i < zombies.size(); )
+    {
+        if (::waitpid(zombies[i].pid, NULL, WNOHANG) != 0) {
+            reaped(zombies[i]);
+            zombies[i] = zombies.back();
+            zombies.pop_back();
+        } else
+            ++i;
+    }
+}
+
+int Server::add_listener(uint16_t port)
+{
+    // CLOEXEC: CGI-Kinder sollen weder Listener noch Client-Sockets erben
+    int s = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0) { logMsg(LogLevel::ERROR, "socket: %s", strerror(errno)); return -1; }
+    int yes = 1;
+    if (::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0) {
+        logMsg(LogLevel::ERROR, "setsockopt: %s", strerror(errno)); ::close(s); return -1;
+    }
+    // jeder Worker bekommt seinen eigenen Socket auf demselben Port
+    if (reuseport && ::setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0) {
+        logMsg(LogLevel::ERROR, "setsockopt SO_REUSEPORT: %s", strerror(errno)); ::close(s); return -1;
+    }
+
+    sockaddr_in a{};
+    a.sin_family      = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    a.sin_port        = htons(port);
+
+    const char* what = NULL;
+    if (::bind(s, (sockaddr*)&a, sizeof(a)) < 0)               what = "bind";
+    else if (::listen(s, 128) < 0)                             what = "listen";
+    else if (make_nonblocking(s) < 0)                          what = "fcntl";
+    else if (!reactor->add(s, EV_READ, FD_TAG | (uint64_t)s)) what = "reactor add";
+    if (what) {
+        logMsg(LogLevel::ERROR, "%s port %u: %s", what, (unsigned)port, strerror(errno));
+        ::close(s);
+        return -1;
+    }
+    listener_fds.insert(s);
+
+    logMsg(LogLevel::INFO, "worker %d listening on 0.0.0.0:%u", id, (unsigned)port);
+    return s;
+}
+
+bool Server::listen()
+{
     std::unordered_map<int, int> lfd_by_port;
 
-    for (size_t s = 0; s < g_cfg.servers.size(); ++s)
+    for (size_t s = 0; s < cfg.servers.size(); ++s)
     {
-        const ServerConfig& sc = g_cfg.servers[s];
+        const ServerConfig& sc = cfg.servers[s];
         int port = sc.listen_port;
 
         if (lfd_by_port.find(port) == lfd_by_port.end())
         {
             int lfd = add_listener(port);
+            if (lfd < 0) return false;
             lfd_by_port[port] = lfd;
             port_by_listener_fd[lfd] = port;
-            std::cout << "Listening on *:" << port << " (lfd=" << lfd << ")\n";
         }
         servers_by_port[port].push_back(s);
     }
+    // Änderungen an gecachten Dateien kommen als Events über denselben Reactor
+    if (files.fd() >= 0 && !reactor->add(files.fd(), EV_READ, FD_TAG | (uint64_t)files.fd()))
+        logMsg(LogLevel::WARN, "reactor add inotify: %s", strerror(errno));
+    return true;
+}
 
-    const long IDLE_MS = 1500000; // timeout zeit
-    char buf[4096];
-    std::cout << "Echo server with write-buffer on port 8080...\n";
+// "1.2.3.4" bzw. "::1" für das Access-Log
+static std::string peer_address(const sockaddr_storage& ss)
+{
+    char buf[INET6_ADDRSTRLEN] = "-";
+    if (ss.ss_family == AF_INET)
+        inet_ntop(AF_INET, &((const sockaddr_in&)ss).sin_addr, buf, sizeof(buf));
+    else if (ss.ss_family == AF_INET6)
+        inet_ntop(AF_INET6, &((const sockaddr_in6&)ss).sin6_addr, buf, sizeof(buf));
+    return buf;
+}
 
+void Server::accept_clients(int lfd, long now_ms)
+{
     for (;;)
 	{
-        // zeit setup
-        using clock_t = std::chrono::steady_clock;
-        using ms      = std::chrono::milliseconds;
-
-        long now_ms = std::chrono::duration_cast<ms>(clock_t::now().time_since_epoch()).count();
-        for (size_t i = 1; i < fds.size(); ++i) {
-            if (listener_fds.count(fds[i].fd)) continue;
-            if (now_ms - clients[i].last_active_ms > IDLE_MS) {
-                std::cerr << "[TIMEOUT] fd=" << fds[i].fd
-                        << " idle=" << (now_ms - clients[i].last_active_ms) << "ms\n";
-                ::close(fds[i].fd);
-                fds.erase(fds.begin()+i);
-                clients.erase(clients.begin()+i);
-                --i;
-            }
+        sockaddr_storage peer;
+        socklen_t plen = sizeof(peer);
+        int cfd = ::accept4(lfd, (sockaddr*)&peer, &plen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (cfd < 0)
+		{
+            if (errno==EAGAIN || errno==EWOULDBLOCK) break;
+            logMsg(LogLevel::ERROR, "accept: %s", strerror(errno)); break;
         }
 
-        //poll
-        int ready = poll(&fds[0], fds.size(), 1000);
-        if (ready < 0) { if (errno==EINTR) continue; perror("poll"); break; }
+        uint64_t id = clients.insert();
+        Client& c = *clients.get(id);
+        c.id = id;
+        c.fd = cfd;
+        c.events = EV_READ;
+        c.remote = peer_address(peer);
 
-        for (size_t i = 0; i < fds.size(); ++i)
-		{
-            if (fds[i].revents == 0) continue;
+        int port = port_by_listener_fd[lfd];
+        c.listen_port = port;
 
-            int fd = fds[i].fd;
-            bool is_listener = (listener_fds.find(fd) != listener_fds.end());
+        // Default-Server (falls mehrere vHosts auf gleichem Port – später durch Host-Header präzisieren)
+        c.server_idx = servers_by_port[port].front();
 
-            if (is_listener)
-			{
-                for (;;)
-				{
-                    int cfd = accept(fd, NULL, NULL);
-                    if (cfd < 0)
-					{
-                        if (errno==EAGAIN || errno==EWOULDBLOCK) break;
-                        perror("accept"); break;
-                    }
-                    make_nonblocking(cfd);
-                    pollfd cp{}; cp.fd = cfd; cp.events = POLLIN; cp.revents = 0;
-                    fds.push_back(cp);
+        // Body-Limit erstmal mit Server-Default belegen (wird nach Host-Match evtl. noch aktualisiert)
+        const ServerConfig& sc0 = cfg.servers[c.server_idx];
+        c.max_body_bytes = sc0.client_max_body_size;
 
-                    Client c;
-                    c.last_active_ms = now_ms;
+        if (!reactor->add(cfd, EV_READ, id)) {
+            logMsg(LogLevel::ERROR, "reactor add: %s", strerror(errno));
+            ::close(cfd); clients.erase(id); continue;
+        }
+        update_timer(c, now_ms, false);
+        WorkerMetrics::add(stats.accepted);
 
+        logMsg(LogLevel::DEBUG, "new client %s fd=%d via port %d -> server#%zu", c.remote.c_str(), cfd, port, c.server_idx);
+    }
+}
 
-                   int port = port_by_listener_fd[fd];
-                    c.listen_port = port;
+bool Server::run()
+{
+    std::vector<ReactorEvent> events;
+    logMsg(LogLevel::INFO, "worker %d event backend: %s", id, reactor->name());
 
-                    // Default-Server (falls mehrere vHosts auf gleichem Port – später durch Host-Header präzisieren)
-                    c.server_idx = servers_by_port[port].front();
+    for (;;)
+	{
+        // abgelaufene Timer abarbeiten, kein Scan über alle Clients
+        long now_ms = monotonic_ms();
+        expired.clear();
+        timers.advance(now_ms, expired);
+        for (size_t t = 0; t < expired.size(); ++t)
+            on_timeout(expired[t]);
+        if (!zombies.empty())
+            reap_children();
+        // FastCGI-Ergebnisse aus dem letzten Durchlauf (Events, Abbrüche, Timeouts)
+        if (!fcgi_done.empty())
+            handle_fcgi_done(now_ms);
 
-                    // Body-Limit erstmal mit Server-Default belegen (wird nach Host-Match evtl. noch aktualisiert)
-                    const ServerConfig& sc0 = g_cfg.servers[c.server_idx];
-                    c.max_body_bytes = sc0.client_max_body_size;
-                    clients.push_back(c);
+        // nur bereite fds zurückbekommen, spätestens wenn der nächste Timer fällig ist
+        int ready = reactor->wait(events, timers.nextTimeout(now_ms));
+        if (ready < 0) { if (errno==EINTR) continue; logMsg(LogLevel::ERROR, "%s: %s", reactor->name(), strerror(errno)); return false; }
+        now_ms = monotonic_ms();
 
-                    std::cout << "New client " << cfd << " via port " << port
-                              << " -> server#" << c.server_idx << "\n";
-                }
+        for (size_t e = 0; e < events.size(); ++e)
+		{
+            uint64_t token = events[e].data;
+            int ev = events[e].events;
+
+            if (token & FD_TAG)
+			{
+                int fd = (int)(token & ~FD_TAG);
+                if (fd == files.fd()) files.processEvents();
+                else if (listener_fds.count(fd)) accept_clients(fd, now_ms);
+                else on_fd_event(fd, ev, now_ms);
                 continue;
             }
 
-            if (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+            // Client kann schon in diesem Durchlauf geschlossen worden sein,
+            // dann passt die Generation der Id nicht mehr
+            Client* cp = clients.get(token);
+            if (!cp) continue;
+            Client& c = *cp;
+            int fd = c.fd;
+
+            if (ev & EV_ERROR)
 			{
-                close(fds[i].fd);
-                fds.erase(fds.begin() + i);
-                clients.erase(clients.begin() + i);
-                --i;
+                close_client(c);
                 continue;
             }
 
             // Lesen
-            if (fds[i].revents & POLLIN)
+            bool closed = false;
+            if (ev & EV_READ)
 			{
-                for (;;)
+                while (c.events & EV_READ)   // process_input() nimmt es weg, wenn die Schlange steht
 				{
-                    ssize_t n = ::read(fds[i].fd, buf, sizeof(buf));
+                    ssize_t n = c.rx.readFrom(fd);
                     if (n > 0)
 					{
-                        Client &c = clients[i];
-                        c.last_active_ms = now_ms;
-                        c.rx.append(buf, n);
-
-// ------ hier Leo sein Zeug rein
-// ------ aus raw string alles rausgeholt und in Request struct
-// ------ ab hier
-
-                        // Header komplett?
-                        Request req;
-                        if (c.rx.find("\r\n\r\n") != std::string::npos)
-                        {
-                            req = RequestParser().parse(c.rx);
-                            c.state = RxState::READY; // Für dieses Beispiel direkt READY setzen
-                            c.target = req.path;
-                        }
-
-// ------ leos part ersetzt bis hier
-
-
-                        // Limits an finalen Server anpassen (z. B. 413 später korrekt)
-                        const ServerConfig& sc = g_cfg.servers[c.server_idx];
-                        c.max_body_bytes = sc.client_max_body_size;
-
-                        // ---- Location bestimmen (Longest Prefix Match) ----
-                        auto resolve_location = [](const ServerConfig& sc, const std::string& path)->const LocationConfig&
-						{
-                            size_t best = 0, best_len = 0;
-                            for (size_t i = 0; i < sc.locations.size(); ++i) {
-                                const std::string& p = sc.locations[i].path;
-                                if (!p.empty() && path.compare(0, p.size(), p) == 0 && p.size() > best_len) {
-                                    best = i; best_len = p.size();
-                                }
-                            }
-                            if (best_len == 0) {
-                                for (size_t i = 0; i < sc.locations.size(); ++i)
-                                    if (sc.locations[i].path == "/") return sc.locations[i];
-                                return sc.locations.front();
-                            }
-                            return sc.locations[best];
-                        };
-
-                        const LocationConfig& lc = resolve_location(sc, c.target);
-                        std::cout << "lc root" << lc.root << std::endl;
-                        c.last_active_ms = now_ms;
-
-                        if (c.state == RxState::READY && c.tx.empty())
-                        {
-                            req.conn_fd   = fds[i].fd;
-
-                            ResponseHandler handler;
-                            printf("method: %s, path: %s\n", req.method.c_str(), req.path.c_str());
-                            Response res = handler.handleRequest(req, lc);
-                            //CoreResponse resp =  RequestParser.parse(req); // <- später echtes Modul deines Kumpels
-
-                            c.keep_alive = res.keep_alive; // Server-Core entscheidet final über close/keep-alive
-                            c.tx         = res.toString();
-                            fds[i].events |= POLLOUT;
-                        }
-
-
-// alles mehr oder weniger leo
-
+                        WorkerMetrics::add(stats.bytes_in, n);
+                        if (!c.t_first) c.t_first = monotonic_us();
+                        process_input(c);
+                        update_timer(c, now_ms, true);
                         continue; // weiter lesen, falls Kernel noch mehr hat
                     }
 					else if (n == 0)
 					{
-                        ::close(fds[i].fd);
-                        fds.erase(fds.begin()+i);
-                        clients.erase(clients.begin()+i);
-                        --i; break;
+                        // Client schreibt nichts mehr; ausstehende Antworten noch senden
+                        if (tx_pending(c) || c.cgi) {
+                            c.closing = true;
+                            set_events(c, c.events & ~EV_READ);
+                            break;
+                        }
+                        close_client(c);
+                        closed = true; break;
                     }
 					else
 					{
                         if (errno == EAGAIN || errno == EWOULDBLOCK) break;
-                        perror("read");
-                        ::close(fds[i].fd);
-                        fds.erase(fds.begin()+i);
-                        clients.erase(clients.begin()+i);
-                        --i; break;
+                        if (errno == ENOBUFS) {
+                            // rx am Limit, ohne dass ein Request fertig wurde
+                            int code = (c.state == RxState::READING_HEADERS) ? 431 : 413;
+                            send_error_and_close(c, code, reason_phrase(code));
+                            break;
+                        }
+                        logMsg(LogLevel::INFO, "read: %s", strerror(errno));
+                        close_client(c);
+                        closed = true; break;
                     }
                 }
             }
+            if (closed) continue;
 
             // Schreiben
-            if (fds[i].revents & POLLOUT)
+            if (ev & EV_WRITE)
 			{
-                Client &c = clients[i];
-                while (!c.tx.empty())
+                if (!flush_tx(c, now_ms))
 				{
-                    ssize_t m = write(fds[i].fd, c.tx.data(), c.tx.size());
-                    if (m > 0) { c.tx.erase(0, m); c.last_active_ms = now_ms; continue; }
-                    if (m < 0 && (errno==EAGAIN || errno==EWOULDBLOCK)) break;
-                    if (m < 0) { perror("write"); break; }
+                    close_client(c);
+                    continue;
                 }
-                if (c.tx.empty())
+                if (!tx_pending(c) && c.cgi)
 				{
-                    if (c.keep_alive)
+                    // Script läuft noch: warten, bis es mehr Ausgabe gibt
+                    set_events(c, c.events & ~EV_WRITE);
+                    if (c.cgi->fcgi)
+                        c.cgi->fcgi->resume(c.id, fcgi_done);   // neues Fenster für diesen Request
+                    else if (c.cgi->paused) {
+                        c.cgi->paused = false;
+                        reactor->add(c.cgi->out_fd, EV_READ, FD_TAG | (uint64_t)c.cgi->out_fd);
+                    }
+                }
+                else if (!tx_pending(c))
+				{
+                    if (!c.closing)
 					{
-                        reset_for_next_request(c);
-                        fds[i].events &= ~POLLOUT;          // zurück auf nur lesen
+                        set_events(c, EV_READ);          // zurück auf nur lesen
+                        // wegen vollem tx liegengebliebene Requests weitermachen
+                        if (!c.rx.empty())
+                            process_input(c);
+                        update_timer(c, now_ms, false);  // Keep-Alive-Idle
                         // Verbindung offen lassen
                     }
 					else
 					{
-                        ::close(fds[i].fd);
-                        fds.erase(fds.begin()+i);
-                        clients.erase(clients.begin()+i);
-                        --i;
+                        close_client(c);
                     }
                 }
             }
         }
     }
+}
+
+// "auto" = Anzahl Kerne
+static int worker_count(int n)
+{
+    if (n > 0) return n;
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw ? (int)hw : 1;
+}
+
+static int run_worker(int id, bool reuseport)
+{
+    // Log-Thread pro Prozess (nach fork() neu), bei Threads geteilt
+    Logger::get().start();
+    int rc = 0;
+    {
+        Server srv(g_cfg, id, reuseport);
+        if (!srv.listen() || !srv.run()) rc = 1;
+    }
+    Logger::get().stop();
+    return rc;
+}
+
+static volatile sig_atomic_t g_stop = 0;
+static void on_stop_signal(int) { g_stop = 1; }
+
+// Master wartet auf seine Worker-Prozesse und startet abgestürzte neu
+static int run_worker_processes(int n)
+{
+    std::vector<pid_t> pids(n, -1);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;   // ohne SA_RESTART, damit waitpid() mit EINTR zurückkommt
+    sigaction(SIGINT,  &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    for (;;)
+    {
+        for (int w = 0; w < n && !g_stop; ++w)
+        {
+            if (pids[w] > 0) continue;
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid < 0) { perror("fork"); return 1; }
+            if (pid == 0) {
+                signal(SIGINT,  SIG_DFL);
+                signal(SIGTERM, SIG_DFL);
+                _exit(run_worker(w, true));
+            }
+            pids[w] = pid;
+        }
+        if (g_stop) {
+            for (int k = 0; k < n; ++k) if (pids[k] > 0) kill(pids[k], SIGTERM);
+            while (waitpid(-1, NULL, 0) > 0) {}
+            return 0;
+        }
+
+        int status = 0;
+        pid_t dead = waitpid(-1, &status, 0);
+        if (dead < 0) { if (errno == EINTR) continue; perror("waitpid"); return 1; }
+        for (int w = 0; w < n; ++w)
+        {
+            if (pids[w] != dead) continue;
+            pids[w] = -1;
+            if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+                std::cerr << "worker " << w << " failed to start, giving up\n";
+                for (int k = 0; k < n; ++k) if (pids[k] > 0) kill(pids[k], SIGTERM);
+                return 1;
+            }
+            std::cerr << "worker " << w << " (pid " << dead << ") died, restarting\n";
+        }
+    }
+}
+
+// Exit-Status: 0, wenn alle Worker sauber beendet haben, sonst der erste Fehler
+static int run_worker_threads(int n)
+{
+    std::vector<std::thread> threads;
+    std::vector<int> rcs(n, 0);
+    for (int w = 0; w < n; ++w)
+        threads.push_back(std::thread([w, &rcs] { rcs[w] = run_worker(w, true); }));
+    int rc = 0;
+    for (int w = 0; w < n; ++w) {
+        threads[w].join();
+        if (!rc) rc = rcs[w];
+    }
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    // === 1. AUTOMATISCHER CONFIG-PFAD ===
+    const char* cfg_path = "./config/webserv.conf";
+    if (argc > 1) {
+        cfg_path = argv[1];  // Optional: ./webserv my.conf
+    }
+
+    // === 2. CONFIG LADEN MIT FALLBACK ===
+    try {
+        g_cfg.parse_c(cfg_path);
+        std::cout << "Config geladen: " << cfg_path << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Config-Fehler (" << cfg_path << "): " << e.what() << "\n";
+        std::cerr << "→ Starte mit Default-Server auf 127.0.0.1:8080\n";
+        g_cfg = Config();   // nichts vom halb geparsten Stand übernehmen (Server, Worker, Logs)
+
+        // --- DEFAULT-SERVER MANUELL ANLEGEN ---
+        ServerConfig defaultServer{};
+        defaultServer.listen_host = "127.0.0.1";
+        defaultServer.listen_port = 8080;
+        defaultServer.server_name = "default";
+        defaultServer.client_max_body_size = 1048576;  // 1MB
+
+        LocationConfig defaultLoc{};
+        defaultLoc.path = "/";
+        defaultLoc.root = "./html";
+        defaultLoc.index = "index.html";
+        defaultLoc.autoindex = true;
+        defaultLoc.methods = {"GET", "POST", "DELETE"};
+
+        defaultServer.locations.push_back(defaultLoc);
+        g_cfg.servers.push_back(defaultServer);
+    }
+
+    // === 3. DEFAULTS FÜR ALLE SERVER/LOCATIONS SETZEN ===
+    for (auto& server : g_cfg.servers) {
+        if (server.listen_port == 0) server.listen_port = 80;
+        if (server.client_max_body_size == 0) server.client_max_body_size = g_cfg.default_client_max_body_size;
+        if (server.client_body_buffer_size == 0) server.client_body_buffer_size = g_cfg.default_client_body_buffer_size;
+        if (server.header_timeout <= 0)    server.header_timeout    = g_cfg.default_header_timeout;
+        if (server.body_timeout <= 0)      server.body_timeout      = g_cfg.default_body_timeout;
+        if (server.keepalive_timeout <= 0) server.keepalive_timeout = g_cfg.default_keepalive_timeout;
+        if (server.send_timeout <= 0)      server.send_timeout      = g_cfg.default_send_timeout;
+        if (server.error_pages.empty()) server.error_pages = g_cfg.default_error_pages;
+
+        for (auto& loc : server.locations) {
+            if (loc.index.empty()) loc.index = "index.html";
+            if (loc.cgi_timeout <= 0) loc.cgi_timeout = 60000;
+            if (loc.fastcgi_max_conns == 0) loc.fastcgi_max_conns = 8;
+            if (loc.methods.empty()) loc.methods = {"GET", "POST", "DELETE"};
+            if (loc.error_pages.empty()) loc.error_pages = server.error_pages;
+            if (!loc.autoindex) loc.autoindex = false;
+            // Methoden, Root, Index, CGI einmal kompilieren; Interpreter gleich prüfen
+            loc.policy = LocationPolicy::compile(server, loc);
+            for (std::map<std::string, std::string>::const_iterator m = loc.cgi.begin(); m != loc.cgi.end(); ++m)
+                if (!FcgiPool::isFastCgi(m->second) && ::access(m->second.c_str(), X_OK) != 0)
+                    std::cerr << "Warnung: CGI-Interpreter " << m->second << " (" << m->first
+                              << ") in location " << loc.path << " ist nicht ausführbar\n";
+        }
+        server.router.build(server.locations);
+    }
+
+    // Logs: Dateien hier öffnen, die Worker erben die fds
+    LogLevel level = g_cfg.error_log_level == "debug" ? LogLevel::DEBUG
+                   : g_cfg.error_log_level == "warn"  ? LogLevel::WARN
+                   : g_cfg.error_log_level == "error" ? LogLevel::ERROR : LogLevel::INFO;
+    if (!Logger::get().configure(g_cfg.error_log, level, g_cfg.access_log,
+                                 g_cfg.access_log_format == "json" ? Logger::JSON : Logger::COMBINED))
+        std::cerr << "Warnung: Log-Datei kann nicht geöffnet werden (" << strerror(errno) << ")\n";
+
+    // Schreiben auf einen vom Client geschlossenen Socket soll nicht den Prozess killen
+    signal(SIGPIPE, SIG_IGN);
+
+    // Der FileCache hält fds offen: Soft-Limit für offene Dateien aufs Hard-Limit heben
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
 
-    for (auto &p : fds) ::close(p.fd);
-    return 0;
+    // === 4. WORKER STARTEN ===
+    // Ein Worker = eigener Event-Loop mit eigenen Tabellen; bei mehreren
+    // Workern hat jeder seinen eigenen SO_REUSEPORT-Listener.
+    int procs   = worker_count(g_cfg.worker_processes);
+    int threads = worker_count(g_cfg.worker_threads);
+    // ein Metrik-Slot pro Worker, in Shared Memory (überlebt fork())
+    if (!Metrics::init(procs > 1 ? procs : threads))
+        std::cerr << "Warnung: Metriken nur pro Prozess (mmap: " << strerror(errno) << ")\n";
+    if (procs > 1) {
+        std::cout << "Starting " << procs << " worker processes\n";
+        return run_worker_processes(procs);
+    }
+    if (threads > 1) {
+        std::cout << "Starting " << threads << " worker threads\n";
+        return run_worker_threads(threads);
+    }
+    return run_worker(0, false);
 }
@@ -6,7 +6,7 @@
 /*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/21 09:27:38 by mhummel           #+#    #+#             */
-/*   Updated: 2025/10/27 10:24:15 by nicolewicki      ###   ########.fr       */
+/*   Updated: 2026/10/18 04:16:31 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -19,6 +19,7 @@
 #include <csignal>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -26,6 +27,8 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
 #include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -35,13 +38,60 @@
 #include "HTTPHandler.hpp"
 #include "Response.hpp"
 #include "config.hpp"
+#include "Arena.hpp"
+#include "RxBuffer.hpp"
+#include "Metrics.hpp"
+#include "LocationPolicy.hpp"
+#include "Reactor.hpp"
+#include "ConnTable.hpp"
+#include "TimerWheel.hpp"
+#include "FileCache.hpp"
+#include "ResponseCache.hpp"
+#include "Compression.hpp"
+#include "CGIHandler.hpp"
+#include "FastCGI.hpp"
+#include "OutQueue.hpp"
 
 enum class RxState { READING_HEADERS, READING_BODY, READY };
+// Welcher Timeout gerade läuft (siehe Server::update_timer)
+enum class Phase { NONE, HEADER, BODY, IDLE, SEND, CGI };
+
+// Laufendes CGI einer Verbindung: die Pipes hängen am Reactor des Workers,
+// die Ausgabe geht über den CgiStream direkt in den tx-Puffer des Clients
+struct CgiJob
+{
+    pid_t  pid     = -1;   // -1, sobald das Kind reaped ist (pid könnte neu vergeben sein)
+    int    pidfd   = -1;   // gehört children, gültig solange pid != -1
+    int    in_fd   = -1;   // Request-Body -> stdin (nur bei Body im Speicher)
+    int    out_fd  = -1;   // stdout des Scripts
+    size_t in_off  = 0;    // so viel vom Body ist schon geschrieben
+    long   timeout = 0;    // ms, cgi_timeout der Location
+    FcgiPool* fcgi = NULL; // != NULL: läuft über FastCGI statt als eigener Prozess
+    bool   paused  = false; // stdout abgemeldet, bis der Client aufgeholt hat
+    CgiStream stream;
+};
+
+// noch nicht reapter CGI-Prozess und der Client, dessen CgiJob auf ihn zeigt
+struct CgiChild
+{
+    pid_t    pid;
+    uint64_t client;
+};
 
 struct Client
 {
-    std::string rx; // Rohpuffer: während Header-Phase: Headerbytes; ab Body-Phase: Body/Reste
-    std::string tx; // Antwort
+    uint64_t id = 0;       // stabile Id aus der ConnTable (= Reactor-Token)
+    int fd      = -1;
+    int events  = EV_READ; // aktuell beim Reactor angemeldete Interessen
+
+    RxBuffer rx;    // Rohpuffer (Pool-Block): während Header-Phase: Headerbytes; ab Body-Phase: Body/Reste
+    OutQueue tx;    // Antwort: Header, Bodies, Dateibereiche (writev/sendfile)
+    bool   corked       = false;        // TCP_CORK gesetzt, solange Header + Datei rausgehen
+    std::unique_ptr<CgiJob> cgi;        // != NULL, solange ein CGI für diesen Request läuft
+    size_t rx_off = 0; // bis hierhin ist rx schon verarbeitet (Head/Body)
+    RequestParser parser; // Head-Parser, läuft über mehrere reads
+    RequestArena arena;   // Request-/Response-Daten, nach jeder Antwort am Stück frei
+    Request req{arena.resource()};   // aktueller Request (Body wird hier gesammelt)
 
     // Request-Empfang
     RxState state       = RxState::READING_HEADERS;
@@ -55,21 +105,33 @@ struct Client
     size_t max_body_bytes   = 1 * 1024 * 1024; // 1MB
 
     // Timeout
-    long last_active_ms = 0;
+    Phase phase = Phase::NONE;
+    unsigned requests = 0;       // fertig beantwortete Requests auf dieser Verbindung
 
     std::string method, target, version;
     std::map<std::string,std::string> headers; // optional, später füllen
     bool keep_alive = false;
+    bool closing    = false;   // Antwort mit "Connection: close" ist in tx: keine weiteren Requests parsen
 
     // Chunked-Decoder-Context
-    enum class ChunkState { SIZE, DATA, CRLF_AFTER_DATA, DONE };
+    enum class ChunkState { SIZE, DATA, CRLF_AFTER_DATA, TRAILER, DONE };
     ChunkState ch_state = ChunkState::SIZE;
     size_t     ch_need  = 0;   // noch zu lesende Bytes im DATA-State
 
     // ==== NEU: für Config-Routing ====
     int listen_port = 0;          // vom Listener übernommen
     size_t server_idx = 0;        // welcher Server-Block (wird ggf. nach Host-Header präzisiert)
+    const LocationConfig* loc = NULL;   // Location des aktuellen Requests, einmal pro Request bestimmt
     std::string host;             // aus "Host:" Header (ggf. mit :port, vorher strippen)
+
+    // Access-Log und Metriken
+    std::string remote;           // Client-Adresse aus accept()
+    int    status   = 0;          // Status der Antwort in tx, 0 = noch keine
+    size_t tx_mark  = 0;          // tx.total() am Anfang der Antwort
+    long   t_first  = 0;          // µs (monoton), erstes Byte des Requests da
+    long   t_head   = 0;          // µs, Head komplett
+    long   t_ready  = 0;          // µs, Request komplett, Handler läuft
+    long   t_queued = 0;          // µs, älteste noch nicht gesendete Antwort fertig
 };
 
 struct HeadInfo
@@ -82,9 +144,79 @@ struct HeadInfo
     size_t content_length = 0;
 };
 
+// Ein Server = ein Worker: eigener Reactor, eigene Listener, eigene Clients.
+// Im Multi-Core-Modus laufen mehrere davon (Prozesse oder Threads) parallel
+// auf SO_REUSEPORT-Sockets, der Kernel verteilt die Verbindungen.
 class Server {
 public:
-	void run();
+	Server(const Config& cfg, int id, bool reuseport);
+	~Server();
+
+	bool listen();   // Listener für alle Ports aus der Config öffnen
+	bool run();      // false = Event-Loop mit Fehler abgebrochen
+
+private:
+	Server(const Server&);
+	Server& operator=(const Server&);
+
+	// Reactor-Token für alles, was kein Client-Socket ist (Listener,
+	// inotify-fd, CGI-Pipes, pidfds): Bit 63 gesetzt, Rest = fd.
+	// Client-Ids haben Bit 63 nie.
+	static const uint64_t FD_TAG = 1ULL << 63;
+
+	int  add_listener(uint16_t port);
+	void accept_clients(int lfd, long now_ms);
+	void set_events(Client& c, int events);
+	void update_timer(Client& c, long now_ms, bool progress);
+	void on_timeout(uint64_t cid);
+	void select_server(Client& c);
+	void process_input(Client& c);
+	void stop_reading(Client& c);
+	bool process_request(Client& c);
+	void dispatch(Client& c);
+	bool serve_cached(Client& c, const LocationConfig& lc, std::string& key);
+	void serve_metrics(Client& c);
+	void send_response(Client& c, Response& res);
+	bool flush_tx(Client& c, long now_ms);
+	void start_cgi(Client& c, const LocationConfig& lc, const std::string& script);
+	void start_fastcgi(Client& c, const LocationConfig& lc, const std::string& script, const std::string& upstream);
+	void handle_fcgi_done(long now_ms);
+	void on_fd_event(int fd, int ev, long now_ms);
+	void cgi_read(Client& c, long now_ms);
+	void cgi_write(Client& c);
+	bool cgi_output(Client& c, const char* data, size_t n);
+	void finish_cgi(Client& c, long now_ms);
+	void cgi_failed(Client& c, long now_ms);
+	void stop_cgi(Client& c, bool kill_child);
+	int  watch_child(pid_t pid, uint64_t client);
+	void reaped(const CgiChild& child);
+	void reap_children();
+	void close_client(Client& c);
+	void send_error_and_close(Client& c, int code, const std::string& text, const std::string& extra = "");
+	void err400(Client& c) { send_error_and_close(c, 400, "Bad Request"); }
+	void err405(Client& c) { send_error_and_close(c, 405, "Method Not Allowed", "Allow: " + c.loc->policy->allow + "\r\n"); }
+	void err413(Client& c) { send_error_and_close(c, 413, "Payload Too Large"); }
+	void err505(Client& c) { send_error_and_close(c, 505, "HTTP Version Not Supported"); }
+
+	const Config&           cfg;
+	int                     id;
+	bool                    reuseport;
+	WorkerMetrics&          stats;     // Slot dieses Workers (Metrics.hpp)
+	Reactor*                reactor;
+	std::unordered_set<int> listener_fds;
+	ConnTable<Client>       clients;
+	TimerWheel              timers;
+	FileCache               files;     // offene fds + Metadaten für statische GETs
+	std::unique_ptr<GzipCache> gzip;   // nur bei "gzip on"
+	std::unordered_map<const LocationConfig*, std::unique_ptr<ResponseCache> > rcache;  // pro Location
+	std::unordered_map<int /*pipe fd*/, uint64_t /*client id*/> cgi_fds;
+	std::unordered_map<int /*pidfd*/, CgiChild> children;   // CGI-Prozesse, die noch nicht reaped sind
+	std::vector<CgiChild>   zombies;   // Fallback ohne pidfd_open: per WNOHANG einsammeln
+	std::unordered_map<std::string, std::unique_ptr<FcgiPool> > fcgi_pools;   // pro Upstream-Adresse
+	std::vector<FcgiResult> fcgi_done;
+	std::vector<uint64_t>   expired;
+	std::unordered_map<int /*port*/, std::vector<size_t> /*server indices*/> servers_by_port;
+	std::unordered_map<int /*lfd*/,  int /*port*/>      port_by_listener_fd;
 };
 
 #endif
@@ -0,0 +1,137 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:15:08 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:15:08 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "TimerWheel.hpp"
+
+TimerWheel::TimerWheel(long now_ms) : _tick((uint64_t)now_ms / TICK_MS), _count(0)
+{
+	for (int l = 0; l < LEVELS; ++l)
+		for (int s = 0; s < SLOTS; ++s)
+			_head[l][s] = NIL;
+}
+
+// Ebene nach Abstand zum aktuellen Tick wählen; zu weite Timer landen
+// in der obersten Ebene und werden beim Kaskadieren neu einsortiert
+void TimerWheel::link(uint32_t n)
+{
+	Node& nd = _nodes[n];
+	uint64_t delta = nd.tick - _tick;
+	int level = 0;
+	while (level < LEVELS - 1 && delta >= ((uint64_t)1 << (BITS * (level + 1))))
+		++level;
+	uint64_t t = nd.tick;
+	if (level == LEVELS - 1 && delta >= ((uint64_t)1 << (BITS * LEVELS)))
+		t = _tick + ((uint64_t)1 << (BITS * LEVELS)) - 1;
+	nd.level = (uint8_t)level;
+	nd.slot  = (uint8_t)((t >> (BITS * level)) & (SLOTS - 1));
+	nd.prev  = NIL;
+	nd.next  = _head[level][nd.slot];
+	if (nd.next != NIL) _nodes[nd.next].prev = n;
+	_head[level][nd.slot] = n;
+}
+
+void TimerWheel::unlink(uint32_t n)
+{
+	Node& nd = _nodes[n];
+	if (nd.prev != NIL) _nodes[nd.prev].next = nd.next;
+	else                _head[nd.level][nd.slot] = nd.next;
+	if (nd.next != NIL) _nodes[nd.next].prev = nd.prev;
+	nd.prev = nd.next = NIL;
+}
+
+void TimerWheel::schedule(uint64_t id, long expires_ms)
+{
+	uint32_t n = (uint32_t)(id & 0xffffffffu);
+	if (n >= _nodes.size()) _nodes.resize(n + 1);
+	Node& nd = _nodes[n];
+	if (nd.armed) unlink(n);
+	else          ++_count;
+	uint64_t t = (expires_ms <= 0) ? 0 : ((uint64_t)expires_ms + TICK_MS - 1) / TICK_MS;
+	nd.id    = id;
+	nd.tick  = (t <= _tick) ? _tick + 1 : t;
+	nd.armed = true;
+	link(n);
+}
+
+void TimerWheel::cancel(uint64_t id)
+{
+	uint32_t n = (uint32_t)(id & 0xffffffffu);
+	if (n >= _nodes.size() || !_nodes[n].armed || _nodes[n].id != id) return;
+	unlink(n);
+	_nodes[n].armed = false;
+	--_count;
+}
+
+// Slot der Ebene `level` auflösen und eine Ebene tiefer einsortieren
+void TimerWheel::cascade(int level)
+{
+	int s = (int)((_tick >> (BITS * level)) & (SLOTS - 1));
+	uint32_t n = _head[level][s];
+	_head[level][s] = NIL;
+	while (n != NIL)
+	{
+		uint32_t next = _nodes[n].next;
+		link(n);
+		n = next;
+	}
+}
+
+void TimerWheel::advance(long now_ms, std::vector<uint64_t>& expired)
+{
+	uint64_t now_tick = (uint64_t)now_ms / TICK_MS;
+	if (_count == 0) { if (now_tick > _tick) _tick = now_tick; return; }
+
+	while (_tick < now_tick)
+	{
+		++_tick;
+		for (int l = 1; l < LEVELS; ++l)
+		{
+			if ((_tick & (((uint64_t)1 << (BITS * l)) - 1)) != 0) break;
+			cascade(l);
+		}
+		int s = (int)(_tick & (SLOTS - 1));
+		uint32_t n = _head[0][s];
+		_head[0][s] = NIL;
+		while (n != NIL)
+		{
+			Node& nd = _nodes[n];
+			uint32_t next = nd.next;
+			nd.prev = nd.next = NIL;
+			if (nd.tick <= _tick)
+			{
+				nd.armed = false;
+				--_count;
+				expired.push_back(nd.id);
+			}
+			else
+				link(n);   // gekappter Ferntimer, weiter warten
+			n = next;
+		}
+		if (_count == 0) { _tick = now_tick; break; }
+	}
+}
+
+int TimerWheel::nextTimeout(long now_ms) const
+{
+	if (_count == 0) return -1;
+	// Ebene 0 deckt die nächsten 63 Ticks exakt ab
+	for (uint64_t t = _tick + 1; t < _tick + SLOTS; ++t)
+	{
+		if (_head[0][t & (SLOTS - 1)] == NIL) continue;
+		long wait = (long)(t * TICK_MS) - now_ms;
+		return wait > 0 ? (int)wait : 0;
+	}
+	// sonst spätestens zum nächsten Kaskadieren aufwachen
+	uint64_t t = (_tick | (SLOTS - 1)) + 1;
+	long wait = (long)(t * TICK_MS) - now_ms;
+	return wait > 0 ? (int)wait : 0;
+}
@@ -0,0 +1,62 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 03:15:08 by nicolewicki       #+#    #+#             */
+/*   Updated: 2026/10/18 03:15:08 by nicolewicki      ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef TIMERWHEEL_HPP
+# define TIMERWHEEL_HPP
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+// Hierarchisches Timer-Rad (4 Ebenen à 64 Slots, 10 ms Auflösung,
+// ~46 h Reichweite). Ein Timer pro Verbindung, Schlüssel ist die
+// ConnTable-Id: schedule/cancel sind O(1), advance amortisiert O(1)
+// pro abgelaufenem Timer, egal wie viele Verbindungen offen sind.
+class TimerWheel
+{
+	public:
+		explicit TimerWheel(long now_ms);
+
+		// (Neu-)Setzen des Timers für id; ein vorher gesetzter wird ersetzt
+		void schedule(uint64_t id, long expires_ms);
+		void cancel(uint64_t id);
+		// Zeit bis now_ms vorspulen, abgelaufene Ids landen in expired
+		void advance(long now_ms, std::vector<uint64_t>& expired);
+		// Wartezeit für poll/epoll: ms bis zum nächsten Timer, -1 wenn keiner
+		int  nextTimeout(long now_ms) const;
+		size_t size() const { return _count; }
+
+	private:
+		enum { LEVELS = 4, BITS = 6, SLOTS = 1 << BITS, TICK_MS = 10 };
+		static const uint32_t NIL = 0xffffffffu;
+
+		struct Node
+		{
+			uint64_t id;
+			uint64_t tick;      // Ablauf in Ticks
+			uint32_t prev, next;
+			uint8_t  level, slot;
+			bool     armed;
+			Node() : id(0), tick(0), prev(NIL), next(NIL), level(0), slot(0), armed(false) {}
+		};
+
+		void link(uint32_t n);
+		void unlink(uint32_t n);
+		void cascade(int level);
+
+		std::vector<Node> _nodes;                  // Index = Slot-Teil der Id
+		uint32_t          _head[LEVELS][SLOTS];
+		uint64_t          _tick;                   // aktueller Tick
+		size_t            _count;
+};
+
+#endif
@@ -6,7 +6,7 @@
 /*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/20 12:53:20 by mhummel           #+#    #+#             */
-/*   Updated: 2025/11/04 11:05:27 by mhummel          ###   ########.fr       */
+/*   Updated: 2026/10/18 04:16:31 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -28,17 +28,40 @@ std::string trim(const std::string& str) {
 
 // Hilfsfunktion: Parst Größenangaben wie 2M oder 1K
 size_t parseSize(const std::string& sizeStr) {
-	size_t size = std::atoi(sizeStr.c_str());
-	if (sizeStr.find('M') != std::string::npos) size *= 1024 * 1024;
+	size_t size = std::strtoull(sizeStr.c_str(), NULL, 10);
+	if (sizeStr.find('G') != std::string::npos) size *= 1024 * 1024 * 1024;
+	else if (sizeStr.find('M') != std::string::npos) size *= 1024 * 1024;
 	else if (sizeStr.find('K') != std::string::npos) size *= 1024;
 	return size;
 }
 
+// Hilfsfunktion: Zeitangaben wie 30s, 500ms, 2m -> Millisekunden (ohne Einheit: Sekunden)
+long parseDuration(const std::string& str) {
+	long n = std::atol(str.c_str());
+	if (str.find("ms") != std::string::npos) return n;
+	if (str.find('m') != std::string::npos) return n * 60 * 1000;
+	if (str.find('h') != std::string::npos) return n * 60 * 60 * 1000;
+	return n * 1000;
+}
+
+// Hilfsfunktion: Worker-Anzahl, "auto" = 0 (wird beim Start auf die Kernzahl gesetzt)
+static int parseWorkers(const std::string& s, int lineNum) {
+	if (s == "auto") return 0;
+	int n = std::atoi(s.c_str());
+	if (n < 1) throw std::runtime_error("Invalid worker count on line " + std::to_string(lineNum));
+	return n;
+}
+
 // Enum für Kontext-Tracking
 enum Context { GLOBAL, SERVER, LOCATION };
 
 // Konstruktor mit Default-Werten
-Config::Config() : default_client_max_body_size(1048576) {}
+Config::Config() : default_client_max_body_size(1048576),
+	default_client_body_buffer_size(64 * 1024), client_body_temp_path("/tmp"),
+	default_header_timeout(60000), default_body_timeout(60000),
+	default_keepalive_timeout(75000), default_send_timeout(60000), event_backend("epoll"), edge_triggered(false),
+	worker_processes(1), worker_threads(1), open_file_cache(1000),
+	gzip(false), gzip_cache(8 * 1024 * 1024), gzip_cache_max_object(1024 * 1024), error_log_level("info"), access_log_format("combined") {}
 
 // Haupt-Parsing-Funktion
 void Config::parse_c(const std::string& filename) {
@@ -132,6 +155,16 @@ void Config::parse_c(const std::string& filename) {
 					currentLocation->methods = params;
 				} else if (key == "cgi" && params.size() >= 2) {
 					currentLocation->cgi[params[0]] = params[1];
+				} else if (key == "response_cache" && !params.empty()) {
+					// response_cache <size> [max_object] | off
+					currentLocation->response_cache_size = (params[0] == "off") ? 0 : parseSize(params[0]);
+					currentLocation->response_cache_max_object = (params.size() > 1) ? parseSize(params[1]) : 64 * 1024;
+				} else if (key == "fastcgi_max_conns" && !params.empty()) {
+					currentLocation->fastcgi_max_conns = std::strtoul(params[0].c_str(), NULL, 10);
+				} else if (key == "metrics" && !params.empty()) {
+					currentLocation->metrics = (params[0] == "on");
+				} else if (key == "cgi_timeout" && !params.empty()) {
+					currentLocation->cgi_timeout = parseDuration(params[0]);
 				} else if (key == "cgi_dir" && !params.empty()) {
 					currentLocation->cgi_dir = params[0];
 				}
@@ -184,6 +217,16 @@ void Config::parse_c(const std::string& filename) {
 				currentServer->error_pages[code] = path;
 			} else if (key == "client_max_body_size" && !params.empty()) {
 				currentServer->client_max_body_size = parseSize(params[0]);
+			} else if (key == "client_body_buffer_size" && !params.empty()) {
+				currentServer->client_body_buffer_size = parseSize(params[0]);
+			} else if (key == "client_header_timeout" && !params.empty()) {
+				currentServer->header_timeout = parseDuration(params[0]);
+			} else if (key == "client_body_timeout" && !params.empty()) {
+				currentServer->body_timeout = parseDuration(params[0]);
+			} else if (key == "keepalive_timeout" && !params.empty()) {
+				currentServer->keepalive_timeout = parseDuration(params[0]);
+			} else if (key == "send_timeout" && !params.empty()) {
+				currentServer->send_timeout = parseDuration(params[0]);
 			}
 		} else if (ctx == GLOBAL) {
 			if (key == "error_page" && !params.empty()) {
@@ -194,14 +237,74 @@ void Config::parse_c(const std::string& filename) {
 			} else if (key == "client_max_body_size" && !params.empty()) {
 				default_client_max_body_size = parseSize(params[0]);
 			}
+			else if (key == "client_body_buffer_size" && !params.empty()) {
+				default_client_body_buffer_size = parseSize(params[0]);
+			}
+			else if (key == "client_body_temp_path" && !params.empty()) {
+				client_body_temp_path = params[0];
+			}
+			else if (key == "client_header_timeout" && !params.empty()) {
+				default_header_timeout = parseDuration(params[0]);
+			}
+			else if (key == "client_body_timeout" && !params.empty()) {
+				default_body_timeout = parseDuration(params[0]);
+			}
+			else if (key == "keepalive_timeout" && !params.empty()) {
+				default_keepalive_timeout = parseDuration(params[0]);
+			}
+			else if (key == "send_timeout" && !params.empty()) {
+				default_send_timeout = parseDuration(params[0]);
+			}
 			else if (key == "data_dir" && !params.empty()) {
 				variables["data_dir"] = params[0];
 			}
+			else if (key == "event_backend" && !params.empty()) {
+				if (params[0] != "epoll" && params[0] != "poll")
+					throw std::runtime_error("Invalid event_backend on line " + std::to_string(lineNum));
+				event_backend = params[0];
+			}
+			else if (key == "edge_triggered" && !params.empty()) {
+				edge_triggered = (params[0] == "on");
+			}
+			else if (key == "worker_processes" && !params.empty()) {
+				worker_processes = parseWorkers(params[0], lineNum);
+			}
+			else if (key == "worker_threads" && !params.empty()) {
+				worker_threads = parseWorkers(params[0], lineNum);
+			}
+			else if (key == "gzip" && !params.empty()) {
+				gzip = (params[0] == "on");
+			}
+			else if (key == "gzip_cache" && !params.empty()) {
+				// gzip_cache <size> [max_object]
+				gzip_cache = parseSize(params[0]);
+				if (params.size() > 1) gzip_cache_max_object = parseSize(params[1]);
+			}
+			else if (key == "error_log" && !params.empty()) {
+				if (params.size() > 1 && params[1] != "debug" && params[1] != "info"
+					&& params[1] != "warn" && params[1] != "error")
+					throw std::runtime_error("Invalid error_log level on line " + std::to_string(lineNum));
+				error_log = (params[0] == "stderr") ? "" : params[0];
+				if (params.size() > 1) error_log_level = params[1];
+			}
+			else if (key == "access_log" && !params.empty()) {
+				if (params.size() > 1 && params[1] != "combined" && params[1] != "json")
+					throw std::runtime_error("Invalid access_log format on line " + std::to_string(lineNum));
+				access_log = (params[0] == "off") ? "" : params[0];
+				if (params.size() > 1) access_log_format = params[1];
+			}
+			else if (key == "open_file_cache" && !params.empty()) {
+				open_file_cache = (params[0] == "off") ? 0 : std::strtoul(params[0].c_str(), NULL, 10);
+			}
 		} else {
 			throw std::runtime_error("Unknown directive: " + key + " on line " + std::to_string(lineNum));
 		}
 	}
 
+	// Prozesse und Threads schließen sich aus: beides > 1 (oder auto) ist ein Fehler
+	if (worker_processes != 1 && worker_threads != 1)
+		throw std::runtime_error("worker_processes and worker_threads cannot both be set");
+
 	for (auto& server : servers) {
 	for (auto& loc : server.locations) {
 		// $(data_dir) ersetzen
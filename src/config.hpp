@@ -6,7 +6,7 @@
 /*   By: mhummel <mhummel@student.42.fr>            +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/10/20 12:53:26 by mhummel           #+#    #+#             */
-/*   Updated: 2025/10/29 12:49:02 by mhummel          ###   ########.fr       */
+/*   Updated: 2026/10/18 04:16:31 by nicolewicki      ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -16,6 +16,10 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include "LocationRouter.hpp"
+
+struct LocationPolicy;
 
 // webserv/
 // ├── src/                     ← Dein Code (main.cpp, config.cpp)
@@ -48,9 +52,15 @@ struct LocationConfig {
 	std::map<std::string, std::string> cgi;  // z.B. {".php", "/usr/bin/php-cgi"}
 	std::map<int, std::string> error_pages;  // Erbt von Server/Global
 	std::string cgi_dir;        // z.B. "./cgi-bin"
+	long cgi_timeout;           // ms, danach wird das Script gekillt (504)
+	size_t fastcgi_max_conns;   // Verbindungen pro Worker zu einem fastcgi://-Upstream
 	std::string error_dir;      // z.B. "./errors"
 	std::string data_dir;       // z.B. "./data"
 	std::string data_store;     // z.B. "$(data_dir)/posts.json"
+	size_t response_cache_size;       // Byte-Budget für fertige Antworten (0 = aus)
+	size_t response_cache_max_object; // größere Dateien werden nicht gecacht
+	bool metrics;                      // "metrics on": Location liefert die Prometheus-Metriken
+	std::shared_ptr<const LocationPolicy> policy;   // beim Start kompiliert (LocationPolicy.hpp)
 };
 
 // Struktur für Server-Konfiguration
@@ -59,8 +69,14 @@ struct ServerConfig {
 	int listen_port;         // z.B. 80
 	std::string server_name;  // z.B. "localhost"
 	std::vector<LocationConfig> locations;
+	LocationRouter router;                  // locations als Trie, nach dem Laden gebaut
 	std::map<int, std::string> error_pages;  // Erbt von Global
 	size_t client_max_body_size;            // Erbt von Global
+	size_t client_body_buffer_size;         // darüber wird der Body in eine Temp-Datei geschrieben
+	long header_timeout;                    // ms, Erbt von Global (client_header_timeout)
+	long body_timeout;                      // ms, zwischen zwei Body-Reads (client_body_timeout)
+	long keepalive_timeout;                 // ms, Leerlauf zwischen Requests
+	long send_timeout;                      // ms, ohne Schreibfortschritt
 };
 
 // Haupt-Konfigurationsklasse
@@ -69,7 +85,25 @@ public:
 	std::vector<ServerConfig> servers;
 	std::map<int, std::string> default_error_pages;  // Globale Error-Pages
 	size_t default_client_max_body_size;            // Globale Body-Size
+	size_t default_client_body_buffer_size;         // Body im Speicher bis zu dieser Größe
+	std::string client_body_temp_path;              // Verzeichnis für große Bodies
+	long default_header_timeout;                    // Globale Timeouts in ms
+	long default_body_timeout;
+	long default_keepalive_timeout;
+	long default_send_timeout;
 	std::map<std::string, std::string> variables;   // z.B. {"data_dir", "/var/www/data"}
+	std::string event_backend;                      // "epoll" (Default) oder "poll"
+	bool edge_triggered;                            // epoll im EPOLLET-Modus
+	int worker_processes;                           // Anzahl Worker-Prozesse (0 = auto)
+	int worker_threads;                             // Anzahl Worker-Threads (0 = auto)
+	size_t open_file_cache;                         // max. Einträge pro Worker (0 = aus)
+	bool gzip;                                      // Accept-Encoding: Sidecars + gzip on the fly
+	size_t gzip_cache;                              // Byte-Budget für selbst komprimierte Dateien
+	size_t gzip_cache_max_object;                   // größere Dateien werden nicht on the fly komprimiert
+	std::string error_log;                          // "error_log <datei> [debug|info|warn|error]", leer = stderr
+	std::string error_log_level;
+	std::string access_log;                         // "access_log <datei>|off [combined|json]", leer = aus
+	std::string access_log_format;
 
 	Config();  // Konstruktor mit Default-Werten
 	void parse_c(const std::string& filename);  // Parsen der Config-Datei
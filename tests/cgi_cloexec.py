@@ -0,0 +1,112 @@
+# **************************************************************************** #
+#                                                                              #
+#                                                         :::      ::::::::    #
+#    cgi_cloexec.py                                     :+:      :+:    :+:    #
+#                                                     +:+ +:+         +:+      #
+#    By: nicolewicki <nicolewicki@student.42.fr>    +#+  +:+       +#+         #
+#                                                 +#+#+#+#+#+   +#+            #
+#    Created: 2026/10/18 04:40:12 by nicolewicki       #+#    #+#              #
+#    Updated: 2026/10/18 04:52:37 by nicolewicki      ###   ########.fr        #
+#                                                                              #
+# **************************************************************************** #
+
+#!/usr/bin/env python3
+# Ein laufendes CGI darf keine fds des Servers erben (nur stdin/stdout/stderr):
+# eine "Connection: close"-Antwort an einen anderen Client muss ihr EOF sofort
+# bekommen, nicht erst, wenn das Script fertig ist. Aufruf: python3 tests/cgi_cloexec.py [./webserv]
+
+import os, socket, subprocess, sys, tempfile, time
+
+PORT  = 8097
+SLEEP = 3
+
+def wait_port():
+    for _ in range(50):
+        try:
+            socket.create_connection(("127.0.0.1", PORT), timeout=0.2).close()
+            return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+# Kind des Servers, dessen Kommandozeile name enthält
+def child_pid(ppid, name):
+    for pid in os.listdir("/proc"):
+        if not pid.isdigit(): continue
+        try:
+            stat = open("/proc/%s/stat" % pid).read()
+            if int(stat.rsplit(")", 1)[1].split()[1]) != ppid: continue
+            if name in open("/proc/%s/cmdline" % pid, "rb").read().decode(errors="replace"):
+                return pid
+        except (OSError, ValueError, IndexError):
+            pass
+    return None
+
+def main():
+    binary = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "./webserv")
+    tmp = tempfile.mkdtemp(prefix="webserv-test-")
+    os.makedirs(tmp + "/html")
+    os.makedirs(tmp + "/cgi-bin")
+    open(tmp + "/html/index.html", "w").write("<h1>ok</h1>\n")
+    open(tmp + "/cgi-bin/slow_cloexec.py", "w").write(
+        "import time\ntime.sleep(%d)\nprint('Content-Type: text/plain\\n')\nprint('done')\n" % SLEEP)
+    open(tmp + "/webserv.conf", "w").write(
+        "error_log stderr warn;\naccess_log off;\n"
+        "server {\n    listen 127.0.0.1:%d;\n"
+        "    location / {\n        root %s/html;\n        allow_methods GET;\n    }\n"
+        "    location /cgi-bin {\n        root %s/cgi-bin;\n        cgi .py %s;\n        allow_methods GET;\n    }\n"
+        "}\n" % (PORT, tmp, tmp, sys.executable))
+
+    srv = subprocess.Popen([binary, tmp + "/webserv.conf"], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    failed = []
+    try:
+        if not wait_port():
+            print("FAIL: server did not start")
+            return 1
+        # schon verbunden, bevor das Script startet: ohne CLOEXEC erbt es diesen Socket
+        c = socket.create_connection(("127.0.0.1", PORT))
+        time.sleep(0.2)
+        cgi = socket.create_connection(("127.0.0.1", PORT))
+        cgi.sendall(b"GET /cgi-bin/slow_cloexec.py HTTP/1.1\r\nHost: localhost\r\n\r\n")
+        time.sleep(0.5)
+
+        pid = child_pid(srv.pid, "slow_cloexec.py")
+        if not pid:
+            failed.append("CGI script not running")
+        else:
+            fds = os.listdir("/proc/%s/fd" % pid)
+            socks = [f for f in fds if os.readlink("/proc/%s/fd/%s" % (pid, f)).startswith("socket:")]
+            if socks:
+                failed.append("CGI child holds %d socket(s)" % len(socks))
+            # alles außer stdin/stdout/stderr ist ein geerbter Server-fd
+            extra = [f for f in fds if int(f) > 2]
+            if extra:
+                failed.append("CGI child inherited fds %s" % ", ".join(
+                    "%s -> %s" % (f, os.readlink("/proc/%s/fd/%s" % (pid, f))) for f in extra))
+
+        t = time.time()
+        c.sendall(b"GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+        c.settimeout(SLEEP + 2)
+        data = b""
+        while True:
+            chunk = c.recv(65536)
+            if not chunk: break
+            data += chunk
+        elapsed = time.time() - t
+        if not data.startswith(b"HTTP/1.1 200"):
+            failed.append("unexpected response %r" % data[:40])
+        if elapsed > 1.0:
+            failed.append("close response took %.1fs (EOF held by the CGI child)" % elapsed)
+        cgi.close()
+    finally:
+        srv.terminate()
+        srv.wait()
+
+    for f in failed:
+        print("FAIL: " + f)
+    if not failed:
+        print("OK: close response completes while a CGI is running")
+    return 1 if failed else 0
+
+if __name__ == "__main__":
+    sys.exit(main())